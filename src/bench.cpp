@@ -0,0 +1,566 @@
+// Microbenchmarks of the better_window pipeline stages. Every result is
+// printed as one JSON object per line, so runs can be collected and compared
+// across commits:
+//   {"bench": ..., "case": ..., "n": ..., "mean_ms": ..., "p50_ms": ...,
+//    "p95_ms": ..., "p99_ms": ..., "rate": ..., "rate_unit": ...}
+// Seek, decode and tracking run on synthetic 720p, 4K and 8K frames unless
+// sources are given; detection and tracking are skipped without a detector.
+// Tracking also prints one track_accuracy line per source, comparing it with
+// detecting every frame. With several detectors, the detectors benchmark runs
+// each on the same frames and prints its agreement with the first.
+
+#include "detection.h"
+#include "detectors.h"
+#include "face_tracker.h"
+#include "frame_source.h"
+#include "gl_texture.h"
+#include "imgui_opengl.h"
+#include "json.h"
+#include "keyframe_index.h"
+#include "preprocess.h"
+#include "profiler.h"
+#include "tiled_detection.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/dnn/dnn.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::vector<std::string> sources;
+  // The first is the one the single-detector benchmarks use.
+  std::vector<btw::DetectorSpec> detectors;
+  btw::DnnOptions dnn;
+  int iterations = 100;
+  // Runs only the benchmark of that name when set.
+  std::string only;
+};
+
+[[nodiscard]] auto parse_options(int argc, char **argv)
+    -> std::optional<Options> {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--source" && i + 1 < argc) {
+      options.sources.emplace_back(argv[++i]);
+    } else if (arg == "--net" && i + 2 < argc) {
+      btw::DetectorSpec spec;
+      spec.config_path = argv[++i];
+      spec.model_path = argv[++i];
+      options.detectors.push_back(spec);
+    } else if (arg == "--detector" && i + 1 < argc) {
+      const auto spec = btw::DetectorSpec::parse(argv[++i]);
+      if (!spec) {
+        return std::nullopt;
+      }
+      options.detectors.push_back(*spec);
+    } else if (arg == "--backend" && i + 1 < argc) {
+      const auto backend = btw::find_dnn_option(btw::dnn_backends, argv[++i]);
+      if (!backend) {
+        return std::nullopt;
+      }
+      options.dnn.backend = *backend;
+    } else if (arg == "--target" && i + 1 < argc) {
+      const auto target = btw::find_dnn_option(btw::dnn_targets, argv[++i]);
+      if (!target) {
+        return std::nullopt;
+      }
+      options.dnn.target = *target;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      cv::setNumThreads(std::max(std::atoi(argv[++i]), 1));
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      options.iterations = std::max(std::atoi(argv[++i]), 1);
+    } else if (arg == "--only" && i + 1 < argc) {
+      options.only = argv[++i];
+    } else {
+      return std::nullopt;
+    }
+  }
+  return options;
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+[[nodiscard]] auto ms_since(bench_clock::time_point start) -> float {
+  return std::chrono::duration<float, std::milli>(bench_clock::now() - start)
+      .count();
+}
+
+// Times body iterations times, after one untimed warm-up call.
+[[nodiscard]] auto time_each(int iterations, const std::function<void()> &body)
+    -> std::vector<float> {
+  body();
+  std::vector<float> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; ++i) {
+    const auto start = bench_clock::now();
+    body();
+    samples.push_back(ms_since(start));
+  }
+  return samples;
+}
+
+// spec with the --backend and --target options, or nullptr after reporting
+// why not to bench.
+[[nodiscard]] auto open_detector(const Options &options,
+                                 btw::DetectorSpec spec, const char *bench)
+    -> std::unique_ptr<btw::Detector> {
+  spec.dnn = options.dnn;
+  auto detector = btw::make_detector(spec);
+  if (!detector->is_open()) {
+    std::cerr << bench << ": can't load " << spec.to_string() << ": "
+              << detector->error() << '\n';
+    return nullptr;
+  }
+  return detector;
+}
+
+// rate_per_ms converts the mean iteration time into the rate_unit figure.
+void emit(const char *bench, const std::string &case_name,
+          const std::vector<float> &samples, double rate_per_ms,
+          const char *rate_unit) {
+  if (samples.empty()) {
+    return;
+  }
+  const auto [p50, p95, p99] = btw::percentiles(samples);
+  const double mean =
+      std::accumulate(begin(samples), end(samples), 0.0) / size(samples);
+  std::cout << "{\"bench\":\"" << bench << "\",\"case\":";
+  btw::write_json_string(std::cout, case_name);
+  std::cout << ",\"n\":" << size(samples) << ",\"mean_ms\":" << mean
+            << ",\"p50_ms\":" << p50 << ",\"p95_ms\":" << p95
+            << ",\"p99_ms\":" << p99
+            << ",\"rate\":" << (mean > 0 ? rate_per_ms / mean : 0.0)
+            << ",\"rate_unit\":\"" << rate_unit << "\"}" << std::endl;
+}
+
+void bench_seek(const Options &options, const std::string &uri) {
+  const auto source = btw::open_frame_source(uri);
+  if (!source->is_open()) {
+    std::cerr << "seek: can't open " << uri << '\n';
+    return;
+  }
+  const int frame_count = source->frame_count();
+  const auto index =
+      btw::KeyframeIndex::load(uri).value_or(btw::KeyframeIndex{});
+
+  std::mt19937 engine(1);
+  std::uniform_int_distribution<int> frames(0, std::max(frame_count - 1, 0));
+  int next_read = -1;
+  cv::Mat frame;
+  const auto samples = time_each(options.iterations, [&] {
+    std::ignore = btw::seek_and_read(*source, index, next_read,
+                                     frames(engine), frame);
+  });
+  const char *const planning = source->random_access() ? "random_access"
+                               : index.empty()         ? "no_index"
+                                                       : "keyframe_index";
+  emit("seek_random", uri + " " + planning, samples, 1000, "seeks/s");
+}
+
+void bench_decode(const Options &options, const std::string &uri) {
+  const auto source = btw::open_frame_source(uri);
+  if (!source->is_open()) {
+    std::cerr << "decode: can't open " << uri << '\n';
+    return;
+  }
+  // A fresh Mat per frame, as FrameDecoder reads them.
+  const auto samples = time_each(options.iterations, [&] {
+    cv::Mat frame;
+    if (!source->read(frame)) {
+      std::ignore = source->seek(0);
+    }
+  });
+  emit("decode_sequential", uri, samples, 1000, "fps");
+}
+
+void bench_detect(const Options &options) {
+  const auto detector =
+      open_detector(options, options.detectors.front(), "detect");
+  if (!detector) {
+    return;
+  }
+
+  constexpr std::array sizes{std::pair{1280, 720}, std::pair{1920, 1080}};
+  for (const auto &[width, height] : sizes) {
+    cv::Mat frame;
+    btw::SyntheticSource(width, height).render(0, frame);
+
+    std::vector<float> preprocess;
+    std::vector<float> forward;
+    btw::DetectionTimings timings;
+    const auto total = time_each(options.iterations, [&] {
+      std::ignore = btw::detect_faces(frame, *detector, &timings);
+      preprocess.push_back(static_cast<float>(timings.preprocess_ms));
+      forward.push_back(static_cast<float>(timings.forward_ms));
+    });
+    // Drop the warm-up call's timings.
+    preprocess.erase(begin(preprocess));
+    forward.erase(begin(forward));
+
+    const auto case_name =
+        std::to_string(width) + "x" + std::to_string(height);
+    emit("detect_preprocess", case_name, preprocess, 1000, "frames/s");
+    emit("detect_forward", case_name, forward, 1000, "frames/s");
+    emit("detect_total", case_name, total, 1000, "frames/s");
+  }
+
+  // Per-frame throughput of one forward pass over batch_size frames.
+  btw::SyntheticSource source(1280, 720);
+  for (const int batch_size : {1, 2, 4, 8, 16}) {
+    std::vector<std::pair<int, cv::Mat>> batch(batch_size);
+    for (int i = 0; i < batch_size; ++i) {
+      batch[i].first = i;
+      source.render(i, batch[i].second);
+    }
+    const auto samples = time_each(options.iterations, [&] {
+      std::ignore = btw::detect_faces_batch(batch, *detector);
+    });
+    emit("detect_batch", "1280x720_batch" + std::to_string(batch_size),
+         samples, 1000.0 * batch_size, "frames/s");
+  }
+}
+
+// The SSD input blob built by cv::resize + blobFromImage (or blobFromImage's
+// own crop) against blob_from_frame, with the largest difference between them.
+void bench_preprocess(const Options &options) {
+  constexpr std::array sizes{std::pair{1280, 720}, std::pair{1920, 1080},
+                             std::pair{3840, 2160}};
+  const cv::Size input(300, 300);
+  const cv::Scalar mean(104, 177, 123);
+
+  for (const auto &[width, height] : sizes) {
+    cv::Mat frame;
+    btw::SyntheticSource(width, height).render(0, frame);
+    const auto size_name =
+        std::to_string(width) + "x" + std::to_string(height);
+
+    for (const auto fit : {btw::BlobFit::stretch, btw::BlobFit::crop}) {
+      const bool crop = fit == btw::BlobFit::crop;
+      cv::Mat reference;
+      const auto two_step = time_each(options.iterations, [&] {
+        if (crop) {
+          reference = cv::dnn::blobFromImage(frame, 1.0, input, mean, false,
+                                             true);
+        } else {
+          cv::Mat resized;
+          cv::resize(frame, resized, input);
+          reference = cv::dnn::blobFromImage(resized, 1.0, input, mean);
+        }
+      });
+      cv::Mat fused;
+      const auto single_pass = time_each(options.iterations, [&] {
+        btw::blob_from_frame(frame, input, mean, fit, fused);
+      });
+
+      const auto case_name = (crop ? "crop_" : "stretch_") + size_name;
+      emit("preprocess_two_step", case_name, two_step, 1000, "frames/s");
+      emit("preprocess_fused", case_name, single_pass, 1000, "frames/s");
+      std::cout << "{\"bench\":\"preprocess_max_error\",\"case\":";
+      btw::write_json_string(std::cout, case_name);
+      std::cout << ",\"max_abs_diff\":"
+                << cv::norm(reference, fused, cv::NORM_INF) << "}"
+                << std::endl;
+    }
+  }
+}
+
+// Tiled detection on a 4K frame at a few tile layouts, against the whole
+// frame alone; each case also reports its tile count and how many faces it
+// found above 0.5.
+void bench_tiling(const Options &options) {
+  const auto detector =
+      open_detector(options, options.detectors.front(), "tiling");
+  if (!detector) {
+    return;
+  }
+  cv::Mat frame;
+  btw::SyntheticSource(3840, 2160).render(0, frame);
+
+  struct Layout {
+    const char *name;
+    btw::TilingConfig config;
+  };
+  const std::array layouts{
+      Layout{"whole", {true, {}}},
+      Layout{"960", {false, {960}}},
+      Layout{"640", {false, {640}}},
+      Layout{"whole+960+480", {true, {960, 480}}},
+  };
+  for (const auto &[name, config] : layouts) {
+    btw::TilingStats stats;
+    btw::Detections detections;
+    const auto samples = time_each(options.iterations, [&] {
+      detections =
+          btw::detect_faces_tiled(frame, *detector, config, nullptr, &stats);
+    });
+    emit("detect_tiled", std::string("3840x2160_") + name, samples, 1000,
+         "frames/s");
+    const auto faces = btw::filter_detections(detections, 0.5f);
+    std::cout << "{\"bench\":\"detect_tiled_tiles\",\"case\":"
+              << "\"3840x2160_" << name << "\",\"tiles\":"
+              << stats.tile_count << ",\"tile_ms\":" << stats.tile_ms
+              << ",\"faces\":" << size(faces) << "}" << std::endl;
+  }
+}
+
+// Detect-then-track against detecting every frame, over iterations
+// consecutive frames of each source.
+void bench_track(const Options &options, const std::string &uri) {
+  const auto detector =
+      open_detector(options, options.detectors.front(), "track");
+  const auto source = btw::open_frame_source(uri);
+  if (!detector) {
+    return;
+  }
+  if (!source->is_open()) {
+    std::cerr << "track: can't open " << uri << '\n';
+    return;
+  }
+
+  btw::FaceTracker tracker;
+  btw::DetectionAccuracy accuracy;
+  std::vector<float> samples;
+  cv::Mat frame;
+  for (int frame_i = 0; frame_i < options.iterations; ++frame_i) {
+    if (!source->read(frame)) {
+      break;
+    }
+    const auto reference = btw::detect_faces(frame, *detector);
+
+    const auto start = bench_clock::now();
+    auto tracked = tracker.track(frame_i, frame);
+    if (!tracked) {
+      tracked = btw::detect_faces(frame, *detector);
+      tracker.keyframe(frame_i, frame, *tracked);
+    }
+    samples.push_back(ms_since(start));
+    accuracy.add(reference, *tracked, 0.5f);
+  }
+
+  const auto [keyframes, tracked_count] = tracker.stats();
+  emit("track", uri, samples, 1000, "frames/s");
+  std::cout << "{\"bench\":\"track_accuracy\",\"case\":";
+  btw::write_json_string(std::cout, uri);
+  std::cout << ",\"frames\":" << size(samples)
+            << ",\"forward_calls\":" << keyframes
+            << ",\"tracked\":" << tracked_count
+            << ",\"forward_reduction\":"
+            << static_cast<double>(size(samples)) / std::max(keyframes, 1)
+            << ",\"recall\":" << accuracy.recall()
+            << ",\"mean_iou\":" << accuracy.mean_iou() << "}" << std::endl;
+}
+
+// Every detector over the same iterations consecutive frames of a source,
+// each also reporting its recall and mean IoU at 0.5 against the first.
+void bench_detectors(const Options &options, const std::string &uri) {
+  std::vector<btw::Detections> reference;
+  for (const auto &spec : options.detectors) {
+    const auto detector = open_detector(options, spec, "detectors");
+    const auto source = btw::open_frame_source(uri);
+    if (!detector) {
+      continue;
+    }
+    if (!source->is_open()) {
+      std::cerr << "detectors: can't open " << uri << '\n';
+      return;
+    }
+
+    std::vector<float> samples;
+    std::vector<btw::Detections> detections;
+    cv::Mat frame;
+    for (int frame_i = 0; frame_i < options.iterations; ++frame_i) {
+      if (!source->read(frame)) {
+        break;
+      }
+      const auto start = bench_clock::now();
+      detections.push_back(btw::detect_faces(frame, *detector));
+      samples.push_back(ms_since(start));
+    }
+    if (reference.empty()) {
+      reference = detections;
+    }
+
+    btw::DetectionAccuracy accuracy;
+    for (std::size_t i = 0; i < std::min(size(reference), size(detections));
+         ++i) {
+      accuracy.add(reference[i], detections[i], 0.5f);
+    }
+    const auto case_name = uri + " " + detector->name();
+    emit("detector_throughput", case_name, samples, 1000, "frames/s");
+    std::cout << "{\"bench\":\"detector_accuracy\",\"case\":";
+    btw::write_json_string(std::cout, case_name);
+    std::cout << ",\"frames\":" << size(detections)
+              << ",\"recall\":" << accuracy.recall()
+              << ",\"mean_iou\":" << accuracy.mean_iou() << "}" << std::endl;
+  }
+}
+
+void bench_upload(const Options &options) {
+  constexpr std::array sizes{std::pair{1280, 720}, std::pair{1920, 1080},
+                             std::pair{3840, 2160}};
+  constexpr std::array modes{
+      std::pair{btw::GLTexture::UploadMode::direct, "direct"},
+      std::pair{btw::GLTexture::UploadMode::pbo, "pbo"},
+      std::pair{btw::GLTexture::UploadMode::persistent, "persistent"}};
+
+  for (const auto &[width, height] : sizes) {
+    const auto size_name =
+        std::to_string(width) + "x" + std::to_string(height);
+    cv::Mat bgr(height, width, CV_8UC3);
+    cv::randu(bgr, 0, 256);
+    const double bgr_mb = bgr.total() * bgr.elemSize() / 1e6;
+
+    for (const auto &[mode, mode_name] : modes) {
+      btw::GLTexture texture;
+      texture.upload_mode = mode;
+      std::int64_t version = 0;
+      // glFinish so each sample covers the transfer, not just queueing it.
+      const auto samples = time_each(options.iterations, [&] {
+        texture.update(bgr, version++);
+        glFinish();
+      });
+      if (texture.last_upload_mode != mode) {
+        std::cerr << "upload: " << mode_name << " unavailable\n";
+        continue;
+      }
+      emit("texture_upload",
+           std::string("bgr8_") + mode_name + "_" + size_name, samples,
+           bgr_mb * 1000, "MB/s");
+    }
+
+    // 4-byte pixels are the driver's native layout on most GPUs, for
+    // comparison with GLTexture's BGR uploads.
+    cv::Mat bgra(height, width, CV_8UC4);
+    cv::randu(bgra, 0, 256);
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA,
+                 GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+    const auto samples = time_each(options.iterations, [&] {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA,
+                      GL_UNSIGNED_INT_8_8_8_8_REV, bgra.ptr());
+      glFinish();
+    });
+    glDeleteTextures(1, &id);
+    emit("texture_upload", "bgra8_direct_" + size_name, samples,
+         bgra.total() * bgra.elemSize() / 1e6 * 1000, "MB/s");
+  }
+}
+
+// Builds a frame of one window holding rect_count filled rects and text.
+void synthetic_frame(btw::ImguiContext_glfw_opengl &context, int rect_count) {
+  context.start_frame();
+  ImGui::SetNextWindowPos({0, 0});
+  ImGui::SetNextWindowSize({1280, 720});
+  ImGui::Begin("synthetic");
+  auto *const draw_list = ImGui::GetWindowDrawList();
+  std::mt19937 engine(1);
+  std::uniform_real_distribution<float> position(0, 1000);
+  for (int i = 0; i < rect_count; ++i) {
+    const ImVec2 min{position(engine), position(engine) * 0.7f};
+    const auto color = IM_COL32((i * 7) & 0xFF, (i * 13) & 0xFF, 200, 128);
+    draw_list->AddRectFilled(min, {min.x + 20, min.y + 20}, color);
+    if (i % 8 == 0) {
+      draw_list->AddText(min, IM_COL32_WHITE, "synthetic");
+    }
+  }
+  ImGui::End();
+  ImGui::Render();
+}
+
+void bench_render(const Options &options,
+                  btw::ImguiContext_glfw_opengl &context) {
+  for (const bool owned : {false, true}) {
+    ImGui_ImplOpenGL3_SetOwnedContext(owned);
+    for (const int rect_count : {100, 1000, 10000}) {
+      synthetic_frame(context, rect_count);
+      const auto *const draw_data = ImGui::GetDrawData();
+      const auto samples = time_each(options.iterations, [&] {
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glFinish();
+      });
+      emit("render_draw_data",
+           std::string(owned ? "owned_" : "") +
+               std::to_string(draw_data->TotalVtxCount) + "_vertices",
+           samples, 1000, "frames/s");
+    }
+  }
+  ImGui_ImplOpenGL3_SetOwnedContext(false);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << "usage: " << argv[0]
+              << " [--source <uri>]... [--net <prototxt> <caffemodel>]"
+                 " [--detector <spec>]...\n"
+                 "  [--backend <name>] [--target <name>] [--threads <n>]"
+                 " [--iterations <n>] [--only <benchmark>]\n";
+    return 2;
+  }
+  const auto selected = [&options](const std::string &name) {
+    return options->only.empty() || options->only == name;
+  };
+
+  const auto sources =
+      options->sources.empty()
+          ? std::vector<std::string>{"synthetic:1280x720",
+                                     "synthetic:3840x2160",
+                                     "synthetic:7680x4320"}
+          : options->sources;
+  for (const auto &uri : sources) {
+    if (selected("seek")) {
+      bench_seek(*options, uri);
+    }
+    if (selected("decode")) {
+      bench_decode(*options, uri);
+    }
+    if (!options->detectors.empty() && selected("track")) {
+      bench_track(*options, uri);
+    }
+    if (!options->detectors.empty() && selected("detectors")) {
+      bench_detectors(*options, uri);
+    }
+  }
+  if (selected("preprocess")) {
+    bench_preprocess(*options);
+  }
+  if (!options->detectors.empty() && selected("detect")) {
+    bench_detect(*options);
+  }
+  if (!options->detectors.empty() && selected("tiling")) {
+    bench_tiling(*options);
+  }
+
+  if (selected("upload") || selected("render")) {
+    btw::ImguiContext_glfw_opengl context(1280, 720, "better_window_bench",
+                                          true);
+    glBindFramebuffer(GL_FRAMEBUFFER, context.fbo);
+    if (selected("upload")) {
+      bench_upload(*options);
+    }
+    if (selected("render")) {
+      bench_render(*options, context);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+namespace btw {
+
+// Raw native-endian reads and writes of trivially copyable values, for the
+// on-disk index files.
+template <typename T> void write_pod(std::ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool read_pod(std::istream &in, T &value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// Bytes between the read position and the end of in, to bound counts read
+// from a possibly corrupt file before allocating for them.
+[[nodiscard]] inline auto remaining_bytes(std::istream &in) -> std::streamoff {
+  const std::streamoff position = in.tellg();
+  if (position < 0) {
+    return 0;
+  }
+  in.seekg(0, std::ios::end);
+  const std::streamoff file_end = in.tellg();
+  in.seekg(position);
+  return file_end < position ? 0 : file_end - position;
+}
+
+} // namespace btw
@@ -0,0 +1,116 @@
+#include "detection.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+auto btw::detect_faces(const cv::Mat &frame, Detector &detector,
+                       DetectionTimings *timings) -> Detections {
+  const std::pair<int, cv::Mat> batch[] = {{0, frame}};
+  return std::move(
+      detect_faces_batch(batch, detector, timings).front().second);
+}
+
+auto btw::detect_faces_batch(std::span<const std::pair<int, cv::Mat>> frames,
+                             Detector &detector, DetectionTimings *timings)
+    -> std::vector<std::pair<int, Detections>> {
+  BTW_TRACE_FUNCTION();
+  using clock = std::chrono::steady_clock;
+  const auto ms_since = [](clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock::now() - start)
+        .count();
+  };
+  DetectionTimings t;
+
+  {
+    const auto start = clock::now();
+    BTW_TRACE_SCOPE("preprocess");
+    std::vector<cv::Mat> images;
+    images.reserve(size(frames));
+    for (const auto &[frame_i, frame] : frames) {
+      images.push_back(frame);
+    }
+    detector.preprocess(images);
+    t.preprocess_ms = ms_since(start);
+  }
+  {
+    const auto start = clock::now();
+    BTW_TRACE_SCOPE("infer");
+    detector.infer();
+    t.forward_ms = ms_since(start);
+  }
+
+  const auto postprocess_start = clock::now();
+  BTW_TRACE_SCOPE("postprocess");
+  auto decoded = detector.decode();
+  decoded.resize(size(frames));
+
+  std::vector<std::pair<int, Detections>> results;
+  results.reserve(size(frames));
+  for (std::size_t i = 0; i < size(frames); ++i) {
+    results.emplace_back(frames[i].first, std::move(decoded[i]));
+  }
+
+  t.postprocess_ms = ms_since(postprocess_start);
+  if (timings) {
+    *timings = t;
+  }
+  return results;
+}
+
+float btw::iou(const std::array<float, 4> &a, const std::array<float, 4> &b) {
+  const float w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+  const float h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+  if (w <= 0 || h <= 0) {
+    return 0;
+  }
+  const float intersection = w * h;
+  const float area_a = (a[2] - a[0]) * (a[3] - a[1]);
+  const float area_b = (b[2] - b[0]) * (b[3] - b[1]);
+  return intersection / (area_a + area_b - intersection);
+}
+
+auto btw::filter_detections(const Detections &detections, float conf_thresh)
+    -> std::vector<std::array<float, 4>> {
+  std::vector<std::array<float, 4>> dt;
+
+  for (const auto &[conf, rect] : detections) {
+    if (conf > conf_thresh) {
+      dt.push_back(rect);
+    }
+  }
+  return dt;
+}
+
+void btw::DetectionAccuracy::add(const Detections &reference_detections,
+                                 const Detections &detections,
+                                 float conf_thresh) {
+  const auto expected = filter_detections(reference_detections, conf_thresh);
+  auto candidates = filter_detections(detections, conf_thresh);
+  for (const auto &rect : expected) {
+    ++reference;
+    // Greedy: each box matches at most one reference box.
+    const auto best = std::max_element(
+        begin(candidates), end(candidates),
+        [&rect](const auto &a, const auto &b) {
+          return iou(rect, a) < iou(rect, b);
+        });
+    if (best == end(candidates)) {
+      continue;
+    }
+    if (const float overlap = iou(rect, *best); overlap >= 0.5f) {
+      ++matched;
+      iou_sum += overlap;
+      candidates.erase(best);
+    }
+  }
+}
+
+double btw::DetectionAccuracy::recall() const {
+  return reference ? static_cast<double>(matched) / reference : 1;
+}
+
+double btw::DetectionAccuracy::mean_iou() const {
+  return matched ? iou_sum / matched : 0;
+}
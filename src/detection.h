@@ -0,0 +1,85 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <array>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace btw {
+
+struct Detection {
+  float confidence;
+  // x0, y0, x1, y1, normalized to the frame size.
+  std::array<float, 4> rect;
+};
+
+using Detections = std::vector<Detection>;
+
+// CPU time of each detection step, in milliseconds.
+struct DetectionTimings {
+  double preprocess_ms = 0;
+  double forward_ms = 0;
+  double postprocess_ms = 0;
+};
+
+// A face detector split into the steps detect_faces_batch times: preprocess
+// a batch of frames into the model's input, run the model, decode its output
+// into one Detections per frame. Not thread safe; make one per thread.
+struct Detector {
+  Detector() = default;
+  Detector(const Detector &) = delete;
+  Detector &operator=(const Detector &) = delete;
+  virtual ~Detector() = default;
+
+  [[nodiscard]] virtual bool is_open() const = 0;
+  [[nodiscard]] virtual auto name() const -> std::string = 0;
+  // Why is_open() is false.
+  [[nodiscard]] virtual auto error() const -> std::string = 0;
+
+  virtual void preprocess(std::span<const cv::Mat> frames) = 0;
+  virtual void infer() = 0;
+  // Every candidate of each frame of the last preprocess, in order, whatever
+  // its confidence, so thresholds can be applied afterwards.
+  [[nodiscard]] virtual auto decode() -> std::vector<Detections> = 0;
+};
+
+[[nodiscard]] auto detect_faces(const cv::Mat &frame, Detector &detector,
+                                DetectionTimings *timings = nullptr)
+    -> Detections;
+
+// Runs the detector once on a batch of frames, tagged with their frame
+// indices, and splits the output back per frame, in input order. Amortizes
+// the per-call inference overhead when many frames are ready at once;
+// timings cover the whole batch.
+[[nodiscard]] auto detect_faces_batch(
+    std::span<const std::pair<int, cv::Mat>> frames, Detector &detector,
+    DetectionTimings *timings = nullptr)
+    -> std::vector<std::pair<int, Detections>>;
+
+// Intersection over union of two normalized rects.
+[[nodiscard]] float iou(const std::array<float, 4> &a,
+                        const std::array<float, 4> &b);
+
+[[nodiscard]] auto filter_detections(const Detections &detections,
+                                     float conf_thresh)
+    -> std::vector<std::array<float, 4>>;
+
+// Agreement of detections against reference ones, each filtered at
+// conf_thresh: reference boxes matched by a box at IoU >= 0.5, and the mean
+// IoU of the matches.
+struct DetectionAccuracy {
+  int reference = 0;
+  int matched = 0;
+  double iou_sum = 0;
+
+  void add(const Detections &reference_detections,
+           const Detections &detections, float conf_thresh);
+
+  [[nodiscard]] double recall() const;
+  [[nodiscard]] double mean_iou() const;
+};
+
+} // namespace btw
@@ -0,0 +1,292 @@
+#include "detection_index.h"
+#include "binary_io.h"
+#include "file_stamp.h"
+#include "frame_source.h"
+#include "keyframe_index.h"
+#include "trace.h"
+
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+static_assert(std::is_trivially_copyable_v<btw::Detection> &&
+                  sizeof(btw::Detection) == 5 * sizeof(float),
+              "Detection is stored as raw bytes in the index file");
+
+constexpr std::array<char, 4> index_magic{'B', 'W', 'D', 'I'};
+constexpr std::uint32_t index_version = 3;
+
+// Consecutive unreadable frames after which analysis takes a worker's source
+// to have ended; container frame counts may overestimate.
+constexpr int max_failed_reads = 8;
+
+// Followed by slot_count + 1 offsets into the records, slot_count analyzed
+// flags padded to 4 bytes, then the records. Slot s holds frame s * stride.
+struct IndexHeader {
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  btw::FileStamp stamp;
+  std::int32_t frame_count;
+  std::int32_t stride;
+  std::uint32_t slot_count;
+  std::uint32_t reserved;
+  // Of the detector key, so another detector's index isn't served.
+  std::uint64_t detector_hash;
+};
+
+// 64-bit FNV-1a: stable across runs and standard libraries, unlike
+// std::hash.
+[[nodiscard]] auto key_hash(const std::string &key) -> std::uint64_t {
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (const char c : key) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+  }
+  return hash;
+}
+
+[[nodiscard]] auto flags_bytes(std::size_t slot_count) -> std::size_t {
+  return (slot_count + 3) / 4 * 4;
+}
+
+// Unanalyzed slots, nullopt, are stored empty and flagged.
+bool write_index(const std::string &video_path, const IndexHeader &header,
+                 const std::vector<std::optional<btw::Detections>> &slots) {
+  const auto path = btw::DetectionIndex::path_for(video_path);
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    btw::write_pod(out, header);
+
+    std::uint32_t offset = 0;
+    btw::write_pod(out, offset);
+    for (const auto &detections : slots) {
+      offset += detections ? size(*detections) : 0;
+      btw::write_pod(out, offset);
+    }
+    std::vector<std::uint8_t> analyzed(flags_bytes(size(slots)));
+    for (std::size_t s = 0; s < size(slots); ++s) {
+      analyzed[s] = slots[s].has_value();
+    }
+    out.write(reinterpret_cast<const char *>(analyzed.data()),
+              size(analyzed));
+    for (const auto &detections : slots) {
+      if (detections) {
+        out.write(reinterpret_cast<const char *>(detections->data()),
+                  size(*detections) * sizeof(btw::Detection));
+      }
+    }
+    if (!out) {
+      return false;
+    }
+  }
+
+  // Readers never see a partially written index.
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  return !ec;
+}
+
+} // namespace
+
+btw::DetectionIndex::DetectionIndex(const std::string &video_path,
+                                    const std::string &detector_key) {
+  const auto stamp = file_stamp(video_path);
+  if (!stamp) {
+    return;
+  }
+
+  const int fd = ::open(path_for(video_path).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) == 0 &&
+      static_cast<std::size_t>(st.st_size) >= sizeof(IndexHeader)) {
+    mapped_size = st.st_size;
+    mapped = ::mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      mapped = nullptr;
+    }
+  }
+  ::close(fd);
+  if (!mapped) {
+    return;
+  }
+
+  const auto *const bytes = static_cast<const std::byte *>(mapped);
+  const auto &header = *reinterpret_cast<const IndexHeader *>(bytes);
+  const auto offsets_bytes = (header.slot_count + std::size_t{1}) * 4;
+  const auto table_bytes = offsets_bytes + flags_bytes(header.slot_count);
+  if (header.magic != index_magic || header.version != index_version ||
+      header.stamp != *stamp ||
+      header.detector_hash != key_hash(detector_key) || header.stride <= 0 ||
+      mapped_size < sizeof(IndexHeader) + table_bytes) {
+    return;
+  }
+
+  const std::span stored_offsets(
+      reinterpret_cast<const std::uint32_t *>(bytes + sizeof(IndexHeader)),
+      header.slot_count + 1);
+  const auto record_count = stored_offsets.back();
+  if (stored_offsets.front() != 0 ||
+      !std::is_sorted(begin(stored_offsets), end(stored_offsets)) ||
+      mapped_size != sizeof(IndexHeader) + table_bytes +
+                         record_count * sizeof(Detection)) {
+    return;
+  }
+
+  frame_stride = header.stride;
+  offsets = stored_offsets;
+  analyzed = std::span(reinterpret_cast<const std::uint8_t *>(
+                           bytes + sizeof(IndexHeader) + offsets_bytes),
+                       header.slot_count);
+  records = std::span(reinterpret_cast<const Detection *>(
+                          bytes + sizeof(IndexHeader) + table_bytes),
+                      record_count);
+}
+
+auto btw::DetectionIndex::path_for(const std::string &video_path)
+    -> std::string {
+  return index_path(video_path, ".detidx");
+}
+
+bool btw::DetectionIndex::is_open() const { return frame_stride > 0; }
+
+int btw::DetectionIndex::stride() const { return frame_stride; }
+
+auto btw::DetectionIndex::find(int frame_i) const
+    -> std::optional<std::span<const Detection>> {
+  if (!is_open() || frame_i < 0 || frame_i % frame_stride != 0) {
+    return std::nullopt;
+  }
+  const std::size_t slot = frame_i / frame_stride;
+  if (slot + 1 >= size(offsets) || !analyzed[slot]) {
+    return std::nullopt;
+  }
+  return records.subspan(offsets[slot], offsets[slot + 1] - offsets[slot]);
+}
+
+btw::DetectionIndex::~DetectionIndex() {
+  if (mapped) {
+    ::munmap(mapped, mapped_size);
+  }
+}
+
+bool btw::analyze_video(
+    const std::string &video_path, const std::string &detector_key,
+    const std::function<std::unique_ptr<Detector>()> &make, int stride,
+    int worker_count, int batch_size, AnalysisProgress &progress,
+    std::stop_token stop) {
+  const auto finish = [&progress](bool succeeded) {
+    progress.succeeded = succeeded;
+    progress.running = false;
+    return succeeded;
+  };
+
+  const auto stamp = file_stamp(video_path);
+  const int frame_count = open_frame_source(video_path)->frame_count();
+  if (!stamp || frame_count <= 0 || stride <= 0 || worker_count <= 0 ||
+      batch_size <= 0) {
+    return finish(false);
+  }
+
+  const int slot_count = (frame_count + stride - 1) / stride;
+  progress.done = 0;
+  progress.total = slot_count;
+
+  const auto keyframes =
+      KeyframeIndex::load(video_path).value_or(KeyframeIndex{});
+  std::vector<std::optional<Detections>> slots(slot_count);
+  std::atomic<bool> failed = false;
+
+  {
+    const int chunk = (slot_count + worker_count - 1) / worker_count;
+    std::vector<std::jthread> workers;
+
+    for (int first = 0; first < slot_count; first += chunk) {
+      const int last = std::min(first + chunk, slot_count);
+      workers.emplace_back([&, first, last] {
+        trace::set_thread_name("analysis " + std::to_string(first / chunk));
+        const auto source = open_frame_source(video_path);
+        const auto detector = make();
+        if (!source->is_open() || !detector->is_open()) {
+          failed = true;
+          return;
+        }
+
+        int next_read = -1;
+        // Frames read for the next forward pass, tagged with their slot.
+        std::vector<std::pair<int, cv::Mat>> batch;
+        batch.reserve(batch_size);
+        int failed_reads = 0;
+        int slot = first;
+        while ((slot < last || !batch.empty()) && !stop.stop_requested() &&
+               !failed) {
+          if (slot < last && failed_reads < max_failed_reads &&
+              static_cast<int>(size(batch)) < batch_size) {
+            // Unreadable frames stay unanalyzed, so the viewer detects them
+            // live; after max_failed_reads in a row, so does the rest of the
+            // chunk.
+            cv::Mat frame;
+            if (seek_and_read(*source, keyframes, next_read, slot * stride,
+                              frame)) {
+              batch.emplace_back(slot, std::move(frame));
+              failed_reads = 0;
+            } else {
+              ++failed_reads;
+              ++progress.done;
+            }
+            ++slot;
+            continue;
+          }
+          if (batch.empty()) {
+            break;
+          }
+
+          std::vector<std::pair<int, Detections>> results;
+          try {
+            results = detect_faces_batch(batch, *detector);
+          } catch (const cv::Exception &) {
+            failed = true;
+            return;
+          }
+          for (auto &[result_slot, detections] : results) {
+            std::erase_if(detections, [](const Detection &detection) {
+              return detection.confidence < DetectionIndex::min_confidence;
+            });
+            slots[result_slot] = std::move(detections);
+            ++progress.done;
+          }
+          batch.clear();
+        }
+        progress.done += last - slot;
+      });
+    }
+  }
+
+  if (failed || stop.stop_requested()) {
+    return finish(false);
+  }
+
+  const IndexHeader header{index_magic,
+                           index_version,
+                           *stamp,
+                           frame_count,
+                           stride,
+                           static_cast<std::uint32_t>(slot_count),
+                           0,
+                           key_hash(detector_key)};
+  return finish(write_index(video_path, header, slots));
+}
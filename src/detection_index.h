@@ -0,0 +1,74 @@
+#pragma once
+
+#include "detection.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+
+namespace btw {
+
+// Detections of every stride-th frame of a video, written once by
+// analyze_video next to the video as "<video>.detidx" and memory-mapped by
+// later sessions. Only rows with confidence >= min_confidence are stored;
+// frames that couldn't be read are stored as not analyzed.
+struct DetectionIndex {
+  static constexpr float min_confidence = 0.1f;
+
+  // detector_key names the detector, e.g. DetectorSpec::to_string(); an
+  // index another detector produced isn't opened.
+  DetectionIndex(const std::string &video_path,
+                 const std::string &detector_key);
+
+  DetectionIndex(const DetectionIndex &) = delete;
+  DetectionIndex(DetectionIndex &&) = delete;
+  DetectionIndex &operator=(const DetectionIndex &) = delete;
+  DetectionIndex &operator=(DetectionIndex &&) = delete;
+
+  [[nodiscard]] static auto path_for(const std::string &video_path)
+      -> std::string;
+
+  // False if the index is missing, corrupt, older than the video or made by
+  // another detector.
+  [[nodiscard]] bool is_open() const;
+  [[nodiscard]] int stride() const;
+
+  // Stored detections of frame_i, nullopt if it was not analyzed.
+  [[nodiscard]] auto find(int frame_i) const
+      -> std::optional<std::span<const Detection>>;
+
+  ~DetectionIndex();
+
+private:
+  void *mapped = nullptr;
+  std::size_t mapped_size = 0;
+  int frame_stride = 0;
+  std::span<const std::uint32_t> offsets;
+  std::span<const std::uint8_t> analyzed;
+  std::span<const Detection> records;
+};
+
+struct AnalysisProgress {
+  std::atomic<int> done = 0;
+  std::atomic<int> total = 0;
+  std::atomic<bool> running = false;
+  std::atomic<bool> succeeded = false;
+};
+
+// Detects faces on every stride-th frame of the video with worker_count
+// threads, each with its own detector from make and its own capture over a
+// disjoint frame range, then writes the DetectionIndex under detector_key.
+// Each worker feeds the detector batch_size frames per call.
+bool analyze_video(const std::string &video_path,
+                   const std::string &detector_key,
+                   const std::function<std::unique_ptr<Detector>()> &make,
+                   int stride, int worker_count, int batch_size,
+                   AnalysisProgress &progress, std::stop_token stop = {});
+
+} // namespace btw
@@ -0,0 +1,172 @@
+#include "detection_worker.h"
+#include "trace.h"
+
+#include <optional>
+
+btw::DetectionWorker::DetectionWorker(std::unique_ptr<Detector> detector,
+                                     std::function<void()> on_result,
+                                     Profiler *profiler)
+    : detector(std::move(detector)), name(this->detector->name()),
+      on_result(std::move(on_result)), profiler(profiler),
+      worker(&DetectionWorker::run, this) {}
+
+void btw::DetectionWorker::submit(int frame_i, const cv::Mat &frame) {
+  const std::lock_guard lock(mutex);
+  if (!failure.empty() || in_flight == frame_i ||
+      (queued && queued->first == frame_i)) {
+    return;
+  }
+  if (queued) {
+    ++counts.dropped;
+  }
+  queued.emplace(frame_i, frame);
+  work_cv.notify_one();
+}
+
+void btw::DetectionWorker::set_detector(std::unique_ptr<Detector> next) {
+  const std::lock_guard lock(mutex);
+  name = next->name();
+  next_detector = std::move(next);
+  failure.clear();
+  ++generation;
+  results.clear();
+}
+
+auto btw::DetectionWorker::detector_name() const -> std::string {
+  const std::lock_guard lock(mutex);
+  return name;
+}
+
+auto btw::DetectionWorker::error() const -> std::string {
+  const std::lock_guard lock(mutex);
+  return failure;
+}
+
+void btw::DetectionWorker::set_tracking(bool enabled) {
+  const std::lock_guard lock(mutex);
+  tracking_enabled = enabled;
+}
+
+bool btw::DetectionWorker::tracking() const {
+  const std::lock_guard lock(mutex);
+  return tracking_enabled;
+}
+
+void btw::DetectionWorker::set_tiling(std::optional<TilingConfig> config) {
+  const std::lock_guard lock(mutex);
+  tiling = std::move(config);
+  ++generation;
+  results.clear();
+}
+
+auto btw::DetectionWorker::stats() const -> Stats {
+  const std::lock_guard lock(mutex);
+  return counts;
+}
+
+auto btw::DetectionWorker::take_results() -> std::vector<Result> {
+  const std::lock_guard lock(mutex);
+  return std::exchange(results, {});
+}
+
+void btw::DetectionWorker::run() {
+  trace::set_thread_name("detection");
+  std::unique_lock lock(mutex);
+  while (true) {
+    work_cv.wait(lock, [this] { return stop || queued; });
+    if (stop) {
+      return;
+    }
+    auto [frame_i, frame] = std::move(*queued);
+    queued.reset();
+    in_flight = frame_i;
+    const bool tracking = tracking_enabled;
+    const auto tiling_config = tiling;
+    const int started = generation;
+    if (next_detector) {
+      detector = std::move(next_detector);
+    }
+    lock.unlock();
+    // Boxes from keyframes detected under other settings aren't carried.
+    if (std::exchange(tracker_generation, started) != started) {
+      tracker.reset();
+    }
+
+    std::optional<Detections> tracked;
+    TilingStats tiling_stats;
+    if (tracking) {
+      std::optional<CpuScope> scope;
+      if (profiler) {
+        scope.emplace(*profiler, Stage::tracking);
+      }
+      tracked = tracker.track(frame_i, frame);
+    } else {
+      tracker.reset();
+    }
+
+    Detections detections;
+    if (tracked) {
+      detections = std::move(*tracked);
+    } else {
+      DetectionTimings timings;
+      // Inference errors, such as a backend failing mid-run, stop detection
+      // until another detector is set instead of ending the process.
+      try {
+        if (tiling_config) {
+          detections = detect_faces_tiled(frame, *detector, *tiling_config,
+                                          &timings, &tiling_stats);
+        } else {
+          detections = detect_faces(frame, *detector, &timings);
+        }
+      } catch (const cv::Exception &e) {
+        lock.lock();
+        in_flight = -1;
+        // A detector set meanwhile gets its own chance.
+        if (generation == started) {
+          failure = e.what();
+          queued.reset();
+        }
+        tracker.reset();
+        if (on_result) {
+          on_result();
+        }
+        continue;
+      }
+      if (profiler) {
+        profiler->record_cpu(Stage::preprocess, timings.preprocess_ms);
+        profiler->record_cpu(Stage::inference, timings.forward_ms);
+        profiler->record_cpu(Stage::postprocess, timings.postprocess_ms);
+        if (tiling_config) {
+          profiler->record_cpu(Stage::tile, tiling_stats.tile_ms);
+        }
+      }
+      if (tracking) {
+        tracker.keyframe(frame_i, frame, detections);
+      }
+    }
+
+    lock.lock();
+    in_flight = -1;
+    ++(tracked ? counts.tracked : counts.forwards);
+    counts.interval = tracker.interval();
+    if (tiling_config && !tracked) {
+      counts.tiling = tiling_stats;
+    }
+    if (generation == started) {
+      results.push_back(
+          {frame_i, std::move(detections), tracked.has_value()});
+    }
+    if (on_result) {
+      on_result();
+    }
+  }
+}
+
+btw::DetectionWorker::~DetectionWorker() {
+  {
+    const std::lock_guard lock(mutex);
+    stop = true;
+  }
+  work_cv.notify_one();
+  worker.join();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "detection.h"
+#include "face_tracker.h"
+#include "profiler.h"
+#include "tiled_detection.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace btw {
+
+// Runs detect_faces on a thread that owns the Detector, so the render loop
+// never waits on inference. Holds at most one queued request:
+// submitting replaces it, so only the latest frame is ever detected next.
+// With tracking on, a FaceTracker answers the frames between detector
+// keyframes. With a tiling config set, detection runs detect_faces_tiled.
+struct DetectionWorker {
+  struct Stats {
+    // Requests replaced by a newer submit before they were detected.
+    int dropped = 0;
+    int forwards = 0;
+    int tracked = 0;
+    int interval = 0;
+    // Of the last tiled detection.
+    TilingStats tiling;
+  };
+
+  struct Result {
+    int frame_i;
+    Detections detections;
+    // Carried from a keyframe by the tracker rather than detected, so only
+    // good for display, not for caching.
+    bool tracked = false;
+  };
+
+  // on_result is called from the worker thread after each detection. The
+  // detection steps are timed into profiler when given.
+  explicit DetectionWorker(std::unique_ptr<Detector> detector,
+                           std::function<void()> on_result = {},
+                           Profiler *profiler = nullptr);
+
+  DetectionWorker(const DetectionWorker &) = delete;
+  DetectionWorker(DetectionWorker &&) = delete;
+  DetectionWorker &operator=(const DetectionWorker &) = delete;
+  DetectionWorker &operator=(DetectionWorker &&) = delete;
+
+  // No-op if frame_i is already queued or being detected, or after the
+  // detector failed.
+  void submit(int frame_i, const cv::Mat &frame);
+
+  // Replaces the detector from the next request on, forgetting the tracks
+  // and any failure. Results of the old detector not yet taken are dropped.
+  void set_detector(std::unique_ptr<Detector> next);
+  [[nodiscard]] auto detector_name() const -> std::string;
+  // The exception that stopped detection, empty while it works.
+  [[nodiscard]] auto error() const -> std::string;
+
+  // Takes effect from the next request; turning it off forgets the tracks.
+  void set_tracking(bool enabled);
+  [[nodiscard]] bool tracking() const;
+
+  // nullopt detects on the whole frame only. Takes effect from the next
+  // request; results of the old config not yet taken are dropped.
+  void set_tiling(std::optional<TilingConfig> config);
+
+  [[nodiscard]] auto stats() const -> Stats;
+
+  // Results completed since the last call.
+  [[nodiscard]] auto take_results() -> std::vector<Result>;
+
+  ~DetectionWorker();
+
+private:
+  void run();
+
+  // Worker thread only, once started.
+  std::unique_ptr<Detector> detector;
+  // Under mutex: set_detector's detector, swapped in by the worker.
+  std::unique_ptr<Detector> next_detector;
+  std::string name;
+  std::string failure;
+  std::function<void()> on_result;
+  Profiler *profiler;
+
+  mutable std::mutex mutex;
+  std::condition_variable work_cv;
+  std::optional<std::pair<int, cv::Mat>> queued;
+  int in_flight = -1;
+  bool tracking_enabled = false;
+  std::optional<TilingConfig> tiling;
+  // Bumped when the detection settings change, so results detected under
+  // older ones are dropped.
+  int generation = 0;
+  Stats counts;
+  // Worker thread only.
+  FaceTracker tracker;
+  int tracker_generation = 0;
+  std::vector<Result> results;
+  bool stop = false;
+
+  std::thread worker;
+};
+
+} // namespace btw
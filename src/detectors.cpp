@@ -0,0 +1,273 @@
+#include "detectors.h"
+#include "preprocess.h"
+#include "tiled_detection.h"
+#include "trace.h"
+
+#include "opencv2/imgproc.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+// Anchor candidates below this are dropped before NMS.
+constexpr float anchor_min_confidence = 0.1f;
+constexpr float anchor_nms_iou = 0.3f;
+
+} // namespace
+
+auto btw::available_dnn_options() -> std::vector<DnnOptions> {
+  std::vector<DnnOptions> available{{}};
+  for (const auto &[backend, target] : cv::dnn::getAvailableBackends()) {
+    available.push_back({backend, target});
+  }
+  return available;
+}
+
+btw::DnnDetector::DnnDetector(cv::dnn::Net net, std::string name,
+                              DnnModel model, DnnOptions options)
+    : net(std::move(net)), label(std::move(name)), model(model) {
+  if (this->net.empty()) {
+    failure = "can't read the model";
+    return;
+  }
+  this->net.setPreferableBackend(options.backend);
+  this->net.setPreferableTarget(options.target);
+  output_names = this->net.getUnconnectedOutLayersNames();
+
+  // Backends and targets missing from the build, or not supporting each
+  // other, only throw on the first forward pass; make that one here rather
+  // than on a detection thread.
+  try {
+    const cv::Mat probe(model.input_size, CV_8UC3, cv::Scalar::all(0));
+    preprocess(std::span(&probe, 1));
+    infer();
+  } catch (const cv::Exception &e) {
+    failure = e.what();
+    this->net = cv::dnn::Net();
+  }
+}
+
+bool btw::DnnDetector::is_open() const { return !net.empty(); }
+
+auto btw::DnnDetector::name() const -> std::string { return label; }
+
+auto btw::DnnDetector::error() const -> std::string { return failure; }
+
+void btw::DnnDetector::preprocess(std::span<const cv::Mat> frames) {
+  const std::size_t blob_count = model.batched ? 1 : size(frames);
+  blobs.resize(blob_count);
+  blob_images.assign(blob_count,
+                     model.batched ? static_cast<int>(size(frames)) : 1);
+  // Each blob keeps its buffer across calls.
+  for (std::size_t b = 0; b < blob_count; ++b) {
+    blob_from_frames(model.batched ? frames : frames.subspan(b, 1),
+                     model.input_size, model.mean, BlobFit::stretch, blobs[b],
+                     model.scale, model.swap_rb);
+  }
+}
+
+void btw::DnnDetector::infer() {
+  outputs.resize(size(blobs));
+  for (std::size_t b = 0; b < size(blobs); ++b) {
+    net.setInput(blobs[b]);
+    net.forward(outputs[b], output_names);
+  }
+}
+
+auto btw::DnnDetector::decode() -> std::vector<Detections> {
+  std::vector<Detections> detections;
+  for (std::size_t b = 0; b < size(outputs); ++b) {
+    auto decoded = model.output == DnnOutput::ssd_rows
+                       ? decode_rows(outputs[b].front(), blob_images[b])
+                       : decode_anchors(outputs[b], blob_images[b]);
+    std::move(begin(decoded), end(decoded), std::back_inserter(detections));
+  }
+  return detections;
+}
+
+auto btw::DnnDetector::decode_rows(const cv::Mat &output, int image_count)
+    -> std::vector<Detections> {
+  std::vector<Detections> detections(image_count);
+  const auto rows = output.reshape(0, std::vector{output.size[2], 7});
+  for (int r = 0; r < rows.rows; ++r) {
+    const auto *const row = rows.ptr<float>(r);
+    // Images without detections may get a placeholder row with image -1.
+    const auto image = static_cast<int>(row[0]);
+    if (image < 0 || image >= image_count) {
+      continue;
+    }
+    detections[image].push_back({row[2], {row[3], row[4], row[5], row[6]}});
+  }
+  return detections;
+}
+
+auto btw::DnnDetector::decode_anchors(const std::vector<cv::Mat> &outputs,
+                                      int image_count)
+    -> std::vector<Detections> {
+  std::vector<Detections> detections(image_count);
+  // Told apart by their last dimension, as export names vary.
+  const auto by_width = [&outputs](int width) -> const cv::Mat * {
+    const auto it = std::find_if(
+        begin(outputs), end(outputs), [width](const cv::Mat &output) {
+          return output.dims == 3 && output.size[2] == width;
+        });
+    return it == end(outputs) ? nullptr : &*it;
+  };
+  const auto *const scores = by_width(2);
+  const auto *const boxes = by_width(4);
+  if (!scores || !boxes || scores->size[1] != boxes->size[1]) {
+    return detections;
+  }
+
+  const int anchors = scores->size[1];
+  for (int image = 0; image < std::min(image_count, scores->size[0]);
+       ++image) {
+    const auto *const score = scores->ptr<float>(image);
+    const auto *const box = boxes->ptr<float>(image);
+    Detections candidates;
+    for (int a = 0; a < anchors; ++a) {
+      if (score[2 * a + 1] < anchor_min_confidence) {
+        continue;
+      }
+      candidates.push_back({score[2 * a + 1],
+                            {box[4 * a], box[4 * a + 1], box[4 * a + 2],
+                             box[4 * a + 3]}});
+    }
+    detections[image] =
+        non_max_suppression(std::move(candidates), anchor_nms_iou);
+  }
+  return detections;
+}
+
+btw::CascadeDetector::CascadeDetector(const std::string &path, int max_width)
+    : cascade(path), label("cascade " + path),
+      max_width(std::max(max_width, 1)) {}
+
+bool btw::CascadeDetector::is_open() const { return !cascade.empty(); }
+
+auto btw::CascadeDetector::name() const -> std::string { return label; }
+
+auto btw::CascadeDetector::error() const -> std::string {
+  return is_open() ? std::string() : "can't load the cascade";
+}
+
+void btw::CascadeDetector::preprocess(std::span<const cv::Mat> frames) {
+  grays.resize(size(frames));
+  for (std::size_t i = 0; i < size(frames); ++i) {
+    cv::Mat gray;
+    cv::cvtColor(frames[i], gray, cv::COLOR_BGR2GRAY);
+    if (gray.cols > max_width) {
+      cv::Mat small;
+      cv::resize(gray, small, {max_width, gray.rows * max_width / gray.cols},
+                 0, 0, cv::INTER_AREA);
+      gray = small;
+    }
+    cv::equalizeHist(gray, grays[i]);
+  }
+}
+
+void btw::CascadeDetector::infer() {
+  found.assign(size(grays), {});
+  for (std::size_t i = 0; i < size(grays); ++i) {
+    const auto &gray = grays[i];
+    std::vector<cv::Rect> rects;
+    std::vector<int> neighbours;
+    cascade.detectMultiScale(gray, rects, neighbours, 1.1, 3, 0, {24, 24});
+    for (std::size_t r = 0; r < size(rects); ++r) {
+      const auto &rect = rects[r];
+      const auto n = static_cast<float>(neighbours[r]);
+      found[i].push_back(
+          {n / (n + 2),
+           {static_cast<float>(rect.x) / gray.cols,
+            static_cast<float>(rect.y) / gray.rows,
+            static_cast<float>(rect.x + rect.width) / gray.cols,
+            static_cast<float>(rect.y + rect.height) / gray.rows}});
+    }
+  }
+}
+
+auto btw::CascadeDetector::decode() -> std::vector<Detections> {
+  return std::exchange(found, {});
+}
+
+auto btw::DetectorSpec::parse(const std::string &text)
+    -> std::optional<DetectorSpec> {
+  const auto colon = text.find(':');
+  if (colon == std::string::npos || colon + 1 == size(text)) {
+    return std::nullopt;
+  }
+  const auto kind = text.substr(0, colon);
+  const auto paths = text.substr(colon + 1);
+
+  DetectorSpec spec;
+  if (kind == "caffe") {
+    const auto comma = paths.find(',');
+    if (comma == std::string::npos) {
+      return std::nullopt;
+    }
+    spec.kind = Kind::caffe;
+    spec.config_path = paths.substr(0, comma);
+    spec.model_path = paths.substr(comma + 1);
+  } else if (kind == "onnx") {
+    spec.kind = Kind::onnx;
+    spec.model_path = paths;
+  } else if (kind == "cascade") {
+    spec.kind = Kind::cascade;
+    spec.model_path = paths;
+  } else {
+    return std::nullopt;
+  }
+  return spec;
+}
+
+auto btw::DetectorSpec::to_string() const -> std::string {
+  switch (kind) {
+  case Kind::caffe:
+    return "caffe:" + config_path + "," + model_path;
+  case Kind::onnx:
+    return "onnx:" + model_path;
+  case Kind::cascade:
+    return "cascade:" + model_path;
+  }
+  return {};
+}
+
+auto btw::make_detector(const DetectorSpec &spec)
+    -> std::unique_ptr<Detector> {
+  BTW_TRACE_FUNCTION();
+  // readNet* throw on unreadable files; an unopened detector reports it.
+  const auto read = [](const auto &read_net) {
+    try {
+      return read_net();
+    } catch (const cv::Exception &) {
+      return cv::dnn::Net();
+    }
+  };
+
+  switch (spec.kind) {
+  case DetectorSpec::Kind::caffe:
+    return std::make_unique<DnnDetector>(
+        read([&spec] {
+          return cv::dnn::readNetFromCaffe(spec.config_path, spec.model_path);
+        }),
+        "res10 SSD (Caffe)", DnnModel{}, spec.dnn);
+  case DetectorSpec::Kind::onnx: {
+    // The Ultra-Light-Fast RFB-320 export: 320x240 RGB, (x - 127) / 128,
+    // fixed batch of one.
+    const DnnModel ultra_light{{320, 240},
+                               {127, 127, 127},
+                               1.0 / 128,
+                               true,
+                               DnnOutput::scores_boxes,
+                               false};
+    return std::make_unique<DnnDetector>(
+        read([&spec] { return cv::dnn::readNetFromONNX(spec.model_path); }),
+        "Ultra-Light-Fast (ONNX)", ultra_light, spec.dnn);
+  }
+  case DetectorSpec::Kind::cascade:
+    break;
+  }
+  return std::make_unique<CascadeDetector>(spec.model_path);
+}
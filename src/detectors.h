@@ -0,0 +1,172 @@
+#pragma once
+
+#include "detection.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/dnn/dnn.hpp"
+#include "opencv2/objdetect.hpp"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace btw {
+
+// The output layouts DnnDetector decodes.
+enum class DnnOutput {
+  // One 1x1xRx7 blob of [image, class, confidence, x0, y0, x1, y1] rows, as
+  // SSDs ending in a DetectionOutput layer produce.
+  ssd_rows,
+  // Raw per-anchor NxPx2 scores and NxPx4 normalized corners, as the
+  // Ultra-Light-Fast face detector's ONNX export produces. Candidates are
+  // thresholded and merged with NMS while decoding.
+  scores_boxes,
+};
+
+// How frames are fed to a network and its output read back.
+struct DnnModel {
+  cv::Size input_size{300, 300};
+  // In the input's channel order, applied before scale.
+  cv::Scalar mean{104, 177, 123};
+  double scale = 1;
+  bool swap_rb = false;
+  DnnOutput output = DnnOutput::ssd_rows;
+  // Whether the network takes a batch dimension above 1; otherwise batches
+  // run one forward pass per frame.
+  bool batched = true;
+};
+
+// cv::dnn::Backend and cv::dnn::Target values.
+struct DnnOptions {
+  int backend = cv::dnn::DNN_BACKEND_DEFAULT;
+  int target = cv::dnn::DNN_TARGET_CPU;
+};
+
+inline constexpr std::array dnn_backends{
+    std::pair{cv::dnn::DNN_BACKEND_DEFAULT, "default"},
+    std::pair{cv::dnn::DNN_BACKEND_OPENCV, "opencv"},
+    std::pair{cv::dnn::DNN_BACKEND_INFERENCE_ENGINE, "openvino"},
+    std::pair{cv::dnn::DNN_BACKEND_CUDA, "cuda"},
+};
+
+inline constexpr std::array dnn_targets{
+    std::pair{cv::dnn::DNN_TARGET_CPU, "cpu"},
+    std::pair{cv::dnn::DNN_TARGET_OPENCL, "opencl"},
+    std::pair{cv::dnn::DNN_TARGET_OPENCL_FP16, "opencl_fp16"},
+    std::pair{cv::dnn::DNN_TARGET_CUDA, "cuda"},
+    std::pair{cv::dnn::DNN_TARGET_CUDA_FP16, "cuda_fp16"},
+};
+
+// The value of the dnn_backends or dnn_targets entry called name.
+template <typename Options>
+[[nodiscard]] auto find_dnn_option(const Options &options,
+                                   std::string_view name)
+    -> std::optional<int> {
+  for (const auto &[value, option_name] : options) {
+    if (name == option_name) {
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+// The dnn_backends or dnn_targets name of value.
+template <typename Options>
+[[nodiscard]] auto dnn_option_name(const Options &options, int value)
+    -> std::string {
+  for (const auto &[option, name] : options) {
+    if (option == value) {
+      return name;
+    }
+  }
+  return std::to_string(value);
+}
+
+// The backend and target pairs this OpenCV build can run, the defaults first.
+[[nodiscard]] auto available_dnn_options() -> std::vector<DnnOptions>;
+
+// A cv::dnn network behind the Detector steps.
+struct DnnDetector final : Detector {
+  // An empty net, or a backend and target that fail a probe forward pass,
+  // leave the detector unopened.
+  DnnDetector(cv::dnn::Net net, std::string name, DnnModel model,
+              DnnOptions options = {});
+
+  [[nodiscard]] bool is_open() const override;
+  [[nodiscard]] auto name() const -> std::string override;
+  [[nodiscard]] auto error() const -> std::string override;
+
+  void preprocess(std::span<const cv::Mat> frames) override;
+  void infer() override;
+  [[nodiscard]] auto decode() -> std::vector<Detections> override;
+
+private:
+  [[nodiscard]] auto decode_rows(const cv::Mat &output, int image_count)
+      -> std::vector<Detections>;
+  [[nodiscard]] auto decode_anchors(const std::vector<cv::Mat> &outputs,
+                                    int image_count)
+      -> std::vector<Detections>;
+
+  cv::dnn::Net net;
+  std::string label;
+  std::string failure;
+  DnnModel model;
+  std::vector<cv::String> output_names;
+
+  // One batched blob, or one per frame when the model isn't batched, with
+  // the number of frames in each and the outputs of each forward pass.
+  std::vector<cv::Mat> blobs;
+  std::vector<int> blob_images;
+  std::vector<std::vector<cv::Mat>> outputs;
+};
+
+// A Haar or LBP cascade: much cheaper than the networks and much less
+// accurate. Confidence comes from the number of neighbouring hits, n / (n + 2).
+struct CascadeDetector final : Detector {
+  // Frames are downscaled to at most max_width before detection.
+  explicit CascadeDetector(const std::string &path, int max_width = 640);
+
+  [[nodiscard]] bool is_open() const override;
+  [[nodiscard]] auto name() const -> std::string override;
+  [[nodiscard]] auto error() const -> std::string override;
+
+  void preprocess(std::span<const cv::Mat> frames) override;
+  void infer() override;
+  [[nodiscard]] auto decode() -> std::vector<Detections> override;
+
+private:
+  cv::CascadeClassifier cascade;
+  std::string label;
+  int max_width;
+
+  std::vector<cv::Mat> grays;
+  std::vector<Detections> found;
+};
+
+// What make_detector builds. The text form is "caffe:<prototxt>,<model>" for
+// the res10 SSD, "onnx:<model>" for an Ultra-Light-Fast face detector and
+// "cascade:<xml>" for a cascade.
+struct DetectorSpec {
+  enum class Kind { caffe, onnx, cascade };
+
+  Kind kind = Kind::caffe;
+  std::string model_path;
+  // The prototxt, for caffe.
+  std::string config_path;
+  DnnOptions dnn;
+
+  [[nodiscard]] static auto parse(const std::string &text)
+      -> std::optional<DetectorSpec>;
+  [[nodiscard]] auto to_string() const -> std::string;
+};
+
+// Check is_open() on the result.
+[[nodiscard]] auto make_detector(const DetectorSpec &spec)
+    -> std::unique_ptr<Detector>;
+
+} // namespace btw
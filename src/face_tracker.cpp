@@ -0,0 +1,154 @@
+#include "face_tracker.h"
+#include "trace.h"
+
+#include "opencv2/imgproc.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Tracking runs on frames downscaled to at most this width.
+constexpr int work_width = 480;
+const cv::Size thumbnail_size(32, 18);
+
+[[nodiscard]] auto thumbnail(const cv::Mat &gray) -> cv::Mat {
+  cv::Mat small;
+  cv::resize(gray, small, thumbnail_size, 0, 0, cv::INTER_AREA);
+  return small;
+}
+
+// Where the normalized rect lies in an image of size, clipped to it.
+[[nodiscard]] auto to_pixels(const std::array<float, 4> &rect, cv::Size size)
+    -> cv::Rect {
+  const cv::Rect pixels(
+      cv::Point(cvRound(rect[0] * size.width), cvRound(rect[1] * size.height)),
+      cv::Point(cvRound(rect[2] * size.width), cvRound(rect[3] * size.height)));
+  return pixels & cv::Rect({}, size);
+}
+
+} // namespace
+
+btw::FaceTracker::FaceTracker(Config config)
+    : config(config),
+      current_interval(std::clamp(5, config.min_interval,
+                                  config.max_interval)) {}
+
+auto btw::FaceTracker::track(int frame_i, const cv::Mat &frame)
+    -> std::optional<Detections> {
+  BTW_TRACE_FUNCTION();
+  if (last_i < 0 || frame_i <= last_i || frame_i - last_i > config.max_gap) {
+    return std::nullopt;
+  }
+  if (frame_i - keyframe_i >= current_interval) {
+    if (run_match >= config.confident_match) {
+      current_interval = std::min(current_interval + 1, config.max_interval);
+    }
+    return std::nullopt;
+  }
+
+  const auto &next_gray = gray_for(frame_i, frame);
+  auto next_thumbnail = thumbnail(next_gray);
+  const double difference = cv::norm(last_thumbnail, next_thumbnail,
+                                     cv::NORM_L1) /
+                            (next_thumbnail.total() * 255.0);
+  if (difference > config.scene_change) {
+    return std::nullopt;
+  }
+
+  const cv::Size image = next_gray.size();
+  const int gap = frame_i - last_i;
+  Detections moved;
+  moved.reserve(size(boxes));
+  float weakest = 1;
+  for (const auto &[confidence, rect] : boxes) {
+    const auto box = to_pixels(rect, image);
+    if (box.width < 4 || box.height < 4) {
+      continue;
+    }
+    // Faces move a fraction of their size per frame; allow that per frame
+    // skipped.
+    const int margin = std::max(4, std::max(box.width, box.height) / 2) * gap;
+    const auto search =
+        cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin,
+                 box.height + 2 * margin) &
+        cv::Rect({}, image);
+
+    cv::Mat scores;
+    cv::matchTemplate(next_gray(search), last_gray(box), scores,
+                      cv::TM_CCOEFF_NORMED);
+    double best = 0;
+    cv::Point best_at;
+    cv::minMaxLoc(scores, nullptr, &best, nullptr, &best_at);
+    if (!std::isfinite(best)) {
+      best = 0;
+    }
+    weakest = std::min(weakest, static_cast<float>(best));
+
+    const cv::Point tl = search.tl() + best_at;
+    moved.push_back(
+        {confidence,
+         {static_cast<float>(tl.x) / image.width,
+          static_cast<float>(tl.y) / image.height,
+          static_cast<float>(tl.x + box.width) / image.width,
+          static_cast<float>(tl.y + box.height) / image.height}});
+  }
+  if (weakest < config.min_match) {
+    shrink_interval();
+    return std::nullopt;
+  }
+
+  run_match = std::min(run_match, weakest);
+  last_i = frame_i;
+  last_gray = next_gray;
+  last_thumbnail = std::move(next_thumbnail);
+  boxes = moved;
+  ++counts.tracked;
+  return moved;
+}
+
+void btw::FaceTracker::keyframe(int frame_i, const cv::Mat &frame,
+                                const Detections &detections) {
+  last_gray = gray_for(frame_i, frame);
+  last_thumbnail = thumbnail(last_gray);
+  last_i = keyframe_i = frame_i;
+  run_match = 1;
+
+  boxes.clear();
+  for (const auto &detection : detections) {
+    if (detection.confidence > config.track_threshold) {
+      boxes.push_back(detection);
+    }
+  }
+  ++counts.keyframes;
+}
+
+void btw::FaceTracker::reset() { last_i = -1; }
+
+int btw::FaceTracker::interval() const { return current_interval; }
+
+auto btw::FaceTracker::stats() const -> const Stats & { return counts; }
+
+auto btw::FaceTracker::gray_for(int frame_i, const cv::Mat &frame)
+    -> const cv::Mat & {
+  if (gray_i == frame_i && !gray.empty()) {
+    return gray;
+  }
+  // Into new buffers: last_gray may share the previous one.
+  cv::Mat full;
+  cv::cvtColor(frame, full, cv::COLOR_BGR2GRAY);
+  if (full.cols > work_width) {
+    cv::Mat small;
+    cv::resize(full, small, {work_width, full.rows * work_width / full.cols},
+               0, 0, cv::INTER_AREA);
+    full = small;
+  }
+  gray = full;
+  gray_i = frame_i;
+  return gray;
+}
+
+void btw::FaceTracker::shrink_interval() {
+  current_interval = std::max(current_interval / 2, config.min_interval);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "detection.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace btw {
+
+// Detect-then-track: the detector runs on keyframes and the boxes are carried
+// to the frames in between by template matching each box from the previous
+// frame within a window around it. A keyframe is due after interval() tracked
+// frames, on a seek, on a scene change or when a box match is weak. The
+// interval grows while tracking stays confident and halves when a box is lost.
+struct FaceTracker {
+  struct Config {
+    int min_interval = 2;
+    int max_interval = 15;
+    // Frames since the last tracked one above which tracking restarts, so
+    // playback dropping a few frames still tracks but a seek doesn't.
+    int max_gap = 4;
+    // Detector rows below this confidence aren't tracked.
+    float track_threshold = 0.3f;
+    // Normalized cross-correlation below which a box counts as lost.
+    float min_match = 0.5f;
+    // Keyframe runs whose weakest match stays above this grow the interval.
+    float confident_match = 0.8f;
+    // Mean absolute thumbnail difference, 0 to 1, that counts as a cut.
+    float scene_change = 0.12f;
+  };
+
+  struct Stats {
+    int keyframes = 0;
+    int tracked = 0;
+  };
+
+  FaceTracker() = default;
+  explicit FaceTracker(Config config);
+
+  // The boxes carried to frame, or nullopt when the detector must run on it;
+  // pass its detections to keyframe() then.
+  [[nodiscard]] auto track(int frame_i, const cv::Mat &frame)
+      -> std::optional<Detections>;
+
+  void keyframe(int frame_i, const cv::Mat &frame,
+                const Detections &detections);
+
+  // Forgets the tracked boxes, so the next frame is a keyframe.
+  void reset();
+
+  [[nodiscard]] int interval() const;
+  [[nodiscard]] auto stats() const -> const Stats &;
+
+private:
+  // frame in grayscale at the tracking resolution, cached for keyframe().
+  [[nodiscard]] auto gray_for(int frame_i, const cv::Mat &frame)
+      -> const cv::Mat &;
+  void shrink_interval();
+
+  Config config;
+  int current_interval = 5;
+
+  // The last frame seen, and the tracked boxes in it.
+  int last_i = -1;
+  int keyframe_i = -1;
+  cv::Mat last_gray;
+  cv::Mat last_thumbnail;
+  Detections boxes;
+  // Weakest match since the last keyframe.
+  float run_match = 1;
+
+  int gray_i = -1;
+  cv::Mat gray;
+
+  Stats counts;
+};
+
+} // namespace btw
@@ -0,0 +1,44 @@
+#include "face_view.h"
+#include "trace.h"
+
+void btw::face_detect(const cv::Mat &frame, const GLTexture &frame_texture,
+                      const Detections &detections) {
+  BTW_TRACE_FUNCTION();
+
+  static float conf_thresh = 0.5;
+  ImGui::SliderFloat("Conf Thresh", &conf_thresh, 0, 1);
+
+  const auto dt = filter_detections(detections, conf_thresh);
+
+  ImGui::Text("toal dec %ld", size(dt));
+
+  auto *const draw_list = ImGui::GetWindowDrawList();
+
+  ImGui::Image(frame_texture);
+  const auto [a0, b0] = ImGui::GetItemRectMin();
+
+  for (const auto [a, b, c, d] : dt) {
+    draw_list->AddRectFilled({a0 + frame.cols * a, b0 + frame.rows * b},
+                             {a0 + frame.cols * c, b0 + frame.rows * d},
+                             ImGui::GetColorU32({0, 0, 1, 0.2}));
+  }
+
+  ImGui::Begin("Faces");
+
+  for (const auto [a, b, c, d] : dt) {
+    const cv::Rect roi(cv::Point(frame.cols * a, frame.rows * b),
+                       cv::Point(frame.cols * c, frame.rows * d));
+
+    if ((roi & cv::Rect(0, 0, frame.cols, frame.rows)) == roi) {
+      const auto [x0, y0] = roi.tl();
+      const auto [x1, y1] = roi.br();
+      ImGui::Image(frame_texture,
+                   {static_cast<float>(x0) / frame.cols,
+                    static_cast<float>(y0) / frame.rows},
+                   {static_cast<float>(x1) / frame.cols,
+                    static_cast<float>(y1) / frame.rows});
+    }
+  }
+
+  ImGui::End();
+}
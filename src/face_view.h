@@ -0,0 +1,15 @@
+#pragma once
+
+#include "detection.h"
+#include "gl_texture.h"
+
+#include "opencv2/core/core.hpp"
+
+namespace btw {
+
+// Draws frame_texture in the current window with the detections above the
+// threshold slider highlighted, and their crops in a "Faces" window.
+void face_detect(const cv::Mat &frame, const GLTexture &frame_texture,
+                 const Detections &detections);
+
+} // namespace btw
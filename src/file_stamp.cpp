@@ -0,0 +1,31 @@
+#include "file_stamp.h"
+
+#include <filesystem>
+
+auto btw::file_stamp(const std::string &path) -> std::optional<FileStamp> {
+  std::error_code ec;
+  // Directories have no size; adding, removing or renaming entries updates
+  // their modification time.
+  const auto file_size = std::filesystem::is_directory(path, ec)
+                             ? 0
+                             : std::filesystem::file_size(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  const auto write_time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  return FileStamp{static_cast<std::int64_t>(file_size),
+                   static_cast<std::int64_t>(
+                       write_time.time_since_epoch().count())};
+}
+
+auto btw::index_path(const std::string &path, const std::string &extension)
+    -> std::string {
+  auto normal = std::filesystem::path(path).lexically_normal();
+  if (!normal.has_filename()) {
+    normal = normal.parent_path();
+  }
+  return normal.string() + extension;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace btw {
+
+// Size and modification time of a file or directory, stored in on-disk
+// indices to detect that what they describe has changed.
+using FileStamp = std::array<std::int64_t, 2>;
+
+[[nodiscard]] auto file_stamp(const std::string &path)
+    -> std::optional<FileStamp>;
+
+// The index file for path: path plus extension, with any trailing separator
+// dropped so a directory's index lands next to it, not in it, and writing it
+// doesn't change the directory's stamp.
+[[nodiscard]] auto index_path(const std::string &path,
+                              const std::string &extension) -> std::string;
+
+} // namespace btw
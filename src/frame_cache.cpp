@@ -0,0 +1,62 @@
+#include "frame_cache.h"
+
+namespace {
+
+[[nodiscard]] std::size_t frame_bytes(const cv::Mat &frame) {
+  return frame.total() * frame.elemSize();
+}
+
+} // namespace
+
+btw::FrameCache::FrameCache(std::size_t budget_bytes)
+    : budget_bytes(budget_bytes) {}
+
+auto btw::FrameCache::get(int frame_i) -> std::optional<cv::Mat> {
+  const auto it = entries.find(frame_i);
+  if (it == end(entries)) {
+    return std::nullopt;
+  }
+  ++counters.hits;
+  lru.splice(begin(lru), lru, it->second);
+  return it->second->second;
+}
+
+void btw::FrameCache::put(int frame_i, const cv::Mat &frame) {
+  if (entries.contains(frame_i)) {
+    return;
+  }
+  ++counters.misses;
+
+  const auto bytes = frame_bytes(frame);
+  if (bytes > budget_bytes) {
+    return;
+  }
+  evict_to(budget_bytes - bytes);
+
+  lru.emplace_front(frame_i, frame);
+  entries.emplace(frame_i, begin(lru));
+  used_bytes += bytes;
+}
+
+void btw::FrameCache::set_budget(std::size_t budget_bytes) {
+  this->budget_bytes = budget_bytes;
+  evict_to(budget_bytes);
+}
+
+std::size_t btw::FrameCache::budget() const { return budget_bytes; }
+
+std::size_t btw::FrameCache::bytes() const { return used_bytes; }
+
+std::size_t btw::FrameCache::frame_count() const { return size(lru); }
+
+auto btw::FrameCache::stats() const -> const Stats & { return counters; }
+
+void btw::FrameCache::evict_to(std::size_t budget_bytes) {
+  while (used_bytes > budget_bytes) {
+    const auto &[frame_i, frame] = lru.back();
+    used_bytes -= frame_bytes(frame);
+    entries.erase(frame_i);
+    lru.pop_back();
+    ++counters.evictions;
+  }
+}
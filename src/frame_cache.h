@@ -0,0 +1,52 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace btw {
+
+// LRU cache of decoded frames keyed by frame index, bounded by the total
+// byte size of the cached pixels. Lookups return cv::Mat headers sharing the
+// cached buffers, never copies.
+struct FrameCache {
+  struct Stats {
+    std::size_t hits = 0;
+    // Frames that were not cached and had to be decoded, counted on put().
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+  };
+
+  explicit FrameCache(std::size_t budget_bytes);
+
+  FrameCache(const FrameCache &) = delete;
+  FrameCache(FrameCache &&) = delete;
+  FrameCache &operator=(const FrameCache &) = delete;
+  FrameCache &operator=(FrameCache &&) = delete;
+
+  [[nodiscard]] auto get(int frame_i) -> std::optional<cv::Mat>;
+  void put(int frame_i, const cv::Mat &frame);
+
+  void set_budget(std::size_t budget_bytes);
+
+  [[nodiscard]] std::size_t budget() const;
+  [[nodiscard]] std::size_t bytes() const;
+  [[nodiscard]] std::size_t frame_count() const;
+  [[nodiscard]] const Stats &stats() const;
+
+private:
+  void evict_to(std::size_t budget_bytes);
+
+  // Most recently used first.
+  std::list<std::pair<int, cv::Mat>> lru;
+  std::unordered_map<int, decltype(lru)::iterator> entries;
+  std::size_t budget_bytes;
+  std::size_t used_bytes = 0;
+  Stats counters;
+};
+
+} // namespace btw
@@ -0,0 +1,158 @@
+#include "frame_decoder.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+btw::FrameDecoder::FrameDecoder(const std::string &path,
+                                std::function<void()> on_ready, int ring_size,
+                                int thread_count)
+    : on_ready(std::move(on_ready)), ring(std::max(ring_size, 2)) {
+  auto source = open_frame_source(path);
+  if (!source->is_open()) {
+    return;
+  }
+  count = source->frame_count();
+  rate = source->fps();
+  const bool random_access = source->random_access();
+  sources.push_back(std::move(source));
+
+  if (random_access) {
+    if (thread_count <= 0) {
+      thread_count = std::clamp<int>(std::thread::hardware_concurrency() / 2,
+                                     1, 8);
+    }
+    while (static_cast<int>(size(sources)) < thread_count) {
+      auto extra = open_frame_source(path);
+      if (!extra->is_open()) {
+        break;
+      }
+      sources.push_back(std::move(extra));
+    }
+  }
+  in_flight.assign(size(sources), -1);
+
+  index = KeyframeIndex::load(path).value_or(KeyframeIndex{});
+  if (index.empty() && !random_access) {
+    indexer = std::jthread([this, path](std::stop_token stop) {
+      trace::set_thread_name("keyframe indexer");
+      auto built = KeyframeIndex::build(path, stop);
+      if (!built) {
+        return;
+      }
+      built->save(path);
+
+      const std::lock_guard lock(mutex);
+      built_index = std::move(built);
+    });
+  }
+  for (std::size_t i = 0; i < size(sources); ++i) {
+    workers.emplace_back(&FrameDecoder::run, this, std::ref(*sources[i]),
+                         static_cast<int>(i));
+  }
+}
+
+bool btw::FrameDecoder::is_open() const { return !workers.empty(); }
+
+int btw::FrameDecoder::frame_count() const { return count; }
+
+double btw::FrameDecoder::fps() const { return rate; }
+
+void btw::FrameDecoder::request(int frame_i) {
+  const std::lock_guard lock(mutex);
+  if (target != frame_i) {
+    target = frame_i;
+    work_cv.notify_all();
+  }
+}
+
+auto btw::FrameDecoder::try_get(int frame_i) -> std::optional<cv::Mat> {
+  const std::lock_guard lock(mutex);
+  const auto &slot = ring[frame_i % size(ring)];
+  if (slot.frame_i != frame_i) {
+    return std::nullopt;
+  }
+  return slot.frame;
+}
+
+auto btw::FrameDecoder::wait(int frame_i) -> cv::Mat {
+  if (!is_open() || frame_i < 0 || frame_i >= count) {
+    return {};
+  }
+  request(frame_i);
+
+  std::unique_lock lock(mutex);
+  const auto &slot = ring[frame_i % size(ring)];
+  done_cv.wait(lock, [&] { return stop || slot.frame_i == frame_i; });
+  return slot.frame_i == frame_i ? slot.frame : cv::Mat();
+}
+
+auto btw::FrameDecoder::next_missing() const -> std::optional<int> {
+  const int ring_size = size(ring);
+  const int ahead = ring_size - ring_size / 4;
+  const int end = std::min(target + ahead, count);
+
+  for (int frame_i = std::max(target, 0); frame_i < end; ++frame_i) {
+    if (ring[frame_i % ring_size].frame_i != frame_i &&
+        std::ranges::find(in_flight, frame_i) == in_flight.end()) {
+      return frame_i;
+    }
+  }
+  return std::nullopt;
+}
+
+void btw::FrameDecoder::run(FrameSource &source, int worker_i) {
+  trace::set_thread_name("decoder " + std::to_string(worker_i));
+  // Position of the frame the next source read returns, -1 when unknown.
+  int next_read = 0;
+
+  std::unique_lock lock(mutex);
+  while (true) {
+    work_cv.wait(lock, [this] { return stop || next_missing(); });
+    if (stop) {
+      return;
+    }
+    if (built_index) {
+      index = std::move(*built_index);
+      built_index.reset();
+    }
+    const int frame_i = *next_missing();
+    in_flight[worker_i] = frame_i;
+    lock.unlock();
+
+    // A fresh Mat per frame: the ring hands out headers sharing this buffer,
+    // so it must never be decoded into again.
+    cv::Mat frame;
+    {
+      BTW_TRACE_SCOPE("decode");
+      if (!seek_and_read(source, index, next_read, frame_i, frame)) {
+        frame.release();
+      }
+    }
+
+    lock.lock();
+    in_flight[worker_i] = -1;
+    ring[frame_i % size(ring)] = {frame_i, frame};
+    done_cv.notify_all();
+    if (frame_i == target && on_ready) {
+      on_ready();
+    }
+  }
+}
+
+btw::FrameDecoder::~FrameDecoder() {
+  indexer.request_stop();
+  if (indexer.joinable()) {
+    indexer.join();
+  }
+  {
+    const std::lock_guard lock(mutex);
+    stop = true;
+  }
+  work_cv.notify_all();
+  done_cv.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
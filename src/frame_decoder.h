@@ -0,0 +1,87 @@
+#pragma once
+
+#include "frame_source.h"
+#include "keyframe_index.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace btw {
+
+// Decodes frames on dedicated threads, each owning its FrameSource.
+// Frames are kept in a bounded ring around the last requested position: most
+// of the ring is read ahead of it, the rest keeps the frames just behind it.
+// Video seeks are planned with the video's KeyframeIndex, which is built on a
+// side thread the first time a video is opened. Random-access sources, whose
+// frames decode independently, are decoded by a pool of threads each with its
+// own source, so the requested frame starts decoding at once while the rest
+// of the window fills in parallel.
+struct FrameDecoder {
+  // path is opened with open_frame_source. on_ready is called from a decoder
+  // thread whenever the last requested frame has been decoded. thread_count
+  // only applies to random-access sources; 0 picks one from the core count.
+  explicit FrameDecoder(const std::string &path,
+                        std::function<void()> on_ready = {},
+                        int ring_size = 32, int thread_count = 0);
+
+  FrameDecoder(const FrameDecoder &) = delete;
+  FrameDecoder(FrameDecoder &&) = delete;
+  FrameDecoder &operator=(const FrameDecoder &) = delete;
+  FrameDecoder &operator=(FrameDecoder &&) = delete;
+
+  [[nodiscard]] bool is_open() const;
+  [[nodiscard]] int frame_count() const;
+  [[nodiscard]] double fps() const;
+
+  // Moves the read-ahead window to start at frame_i. Cheap, never blocks on
+  // decoding.
+  void request(int frame_i);
+
+  // Returns the decoded frame if it is in the ring. An empty cv::Mat means
+  // decoding that frame failed.
+  [[nodiscard]] auto try_get(int frame_i) -> std::optional<cv::Mat>;
+
+  // Blocks until frame_i is decoded (or failed). Requests it first.
+  [[nodiscard]] auto wait(int frame_i) -> cv::Mat;
+
+  ~FrameDecoder();
+
+private:
+  struct Slot {
+    int frame_i = -1;
+    cv::Mat frame;
+  };
+
+  [[nodiscard]] auto next_missing() const -> std::optional<int>;
+  void run(FrameSource &source, int worker_i);
+
+  // One per decoder thread.
+  std::vector<std::unique_ptr<FrameSource>> sources;
+  int count = 0;
+  double rate = 0;
+  KeyframeIndex index;
+  std::function<void()> on_ready;
+
+  mutable std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  std::vector<Slot> ring;
+  // Frame each decoder thread is decoding, -1 when idle.
+  std::vector<int> in_flight;
+  int target = 0;
+  bool stop = false;
+  std::optional<KeyframeIndex> built_index;
+
+  std::jthread indexer;
+  std::vector<std::thread> workers;
+};
+
+} // namespace btw
@@ -0,0 +1,145 @@
+#include "frame_source.h"
+#include "image_sequence.h"
+
+#include "opencv2/imgproc.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view synthetic_prefix = "synthetic:";
+
+} // namespace
+
+btw::VideoSource::VideoSource(const std::string &path) : cap(path) {}
+
+bool btw::VideoSource::is_open() const { return cap.isOpened(); }
+
+int btw::VideoSource::frame_count() const {
+  return static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+}
+
+double btw::VideoSource::fps() const { return cap.get(cv::CAP_PROP_FPS); }
+
+bool btw::VideoSource::random_access() const { return false; }
+
+bool btw::VideoSource::read(cv::Mat &frame) { return cap.read(frame); }
+
+bool btw::VideoSource::grab() { return cap.grab(); }
+
+bool btw::VideoSource::seek(int frame_i) {
+  return cap.set(cv::CAP_PROP_POS_FRAMES, frame_i);
+}
+
+btw::SyntheticSource::SyntheticSource(int width, int height, int frame_count,
+                                      double fps, int face_count)
+    : count(frame_count), rate(fps), face_count(face_count) {
+  if (width <= 0 || height <= 0 || frame_count <= 0 || fps <= 0) {
+    return;
+  }
+
+  // A vertical gradient with diagonal bands, so frames aren't trivially
+  // compressible and moving content shows up.
+  backdrop.create(height, width, CV_8UC3);
+  for (int y = 0; y < height; ++y) {
+    auto *const row = backdrop.ptr<cv::Vec3b>(y);
+    const auto shade = static_cast<unsigned char>(40 + 120 * y / height);
+    for (int x = 0; x < width; ++x) {
+      const bool band = ((x + y) / std::max(height / 12, 1)) % 2;
+      row[x] = {static_cast<unsigned char>(shade + (band ? 30 : 0)),
+                static_cast<unsigned char>(shade / 2 + 20),
+                static_cast<unsigned char>(90 - shade / 4)};
+    }
+  }
+}
+
+bool btw::SyntheticSource::is_open() const { return !backdrop.empty(); }
+
+int btw::SyntheticSource::frame_count() const { return count; }
+
+double btw::SyntheticSource::fps() const { return rate; }
+
+bool btw::SyntheticSource::random_access() const { return true; }
+
+void btw::SyntheticSource::render(int frame_i, cv::Mat &frame) const {
+  backdrop.copyTo(frame);
+
+  const double t = frame_i / rate;
+  const double w = frame.cols;
+  const double h = frame.rows;
+  const double unit = std::min(w, h);
+
+  for (int k = 0; k < face_count; ++k) {
+    const cv::Point center(
+        static_cast<int>(w * (0.5 + 0.35 * std::sin(t * (0.7 + 0.2 * k) + k))),
+        static_cast<int>(
+            h * (0.5 + 0.3 * std::sin(t * (0.5 + 0.15 * k) + 2 * k))));
+    const int r = static_cast<int>(unit * (0.08 + 0.03 * k));
+    const cv::Point eye(r * 2 / 5, r / 4);
+
+    cv::ellipse(frame, center, {r * 4 / 5, r}, 0, 0, 360, {120, 160, 220},
+                cv::FILLED, cv::LINE_AA);
+    cv::circle(frame, center - eye, r / 8, {40, 30, 30}, cv::FILLED,
+               cv::LINE_AA);
+    cv::circle(frame, center + cv::Point(eye.x, -eye.y), r / 8,
+               {40, 30, 30}, cv::FILLED, cv::LINE_AA);
+    cv::ellipse(frame, center + cv::Point(0, r / 3), {r / 3, r / 6}, 0, 0,
+                180, {60, 60, 150}, std::max(r / 20, 1), cv::LINE_AA);
+  }
+
+  const double scale = h / 720;
+  cv::putText(frame, std::to_string(frame_i),
+              {static_cast<int>(20 * scale), static_cast<int>(60 * scale)},
+              cv::FONT_HERSHEY_SIMPLEX, 1.5 * scale, {255, 255, 255},
+              std::max(static_cast<int>(2 * scale), 1), cv::LINE_AA);
+}
+
+bool btw::SyntheticSource::read(cv::Mat &frame) {
+  if (!is_open() || next >= count) {
+    return false;
+  }
+  render(next++, frame);
+  return true;
+}
+
+bool btw::SyntheticSource::grab() {
+  if (next >= count) {
+    return false;
+  }
+  ++next;
+  return true;
+}
+
+bool btw::SyntheticSource::seek(int frame_i) {
+  if (frame_i < 0 || frame_i >= count) {
+    return false;
+  }
+  next = frame_i;
+  return true;
+}
+
+auto btw::open_frame_source(const std::string &uri)
+    -> std::unique_ptr<FrameSource> {
+  if (!is_file_source(uri)) {
+    int width = 0;
+    int height = 0;
+    int frames = 3000;
+    double fps = 30;
+    std::sscanf(uri.c_str() + synthetic_prefix.size(), "%dx%d:%d:%lf", &width,
+                &height, &frames, &fps);
+    return std::make_unique<SyntheticSource>(width, height, frames, fps);
+  }
+  std::error_code error;
+  if (std::filesystem::is_directory(uri, error)) {
+    return std::make_unique<ImageSequenceSource>(uri);
+  }
+  return std::make_unique<VideoSource>(uri);
+}
+
+bool btw::is_file_source(const std::string &uri) {
+  return !uri.starts_with(synthetic_prefix);
+}
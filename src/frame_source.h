@@ -0,0 +1,86 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/videoio.hpp"
+
+#include <memory>
+#include <string>
+
+namespace btw {
+
+// A seekable sequence of BGR frames. Not thread safe; open one per thread.
+struct FrameSource {
+  FrameSource() = default;
+  FrameSource(const FrameSource &) = delete;
+  FrameSource &operator=(const FrameSource &) = delete;
+  virtual ~FrameSource() = default;
+
+  [[nodiscard]] virtual bool is_open() const = 0;
+  [[nodiscard]] virtual int frame_count() const = 0;
+  [[nodiscard]] virtual double fps() const = 0;
+
+  // Whether seek() costs about as much as reading the next frame, so seeks
+  // need no planning.
+  [[nodiscard]] virtual bool random_access() const = 0;
+
+  // Reads the next frame into frame, which is reallocated unless it already
+  // has the frame's size and type.
+  [[nodiscard]] virtual bool read(cv::Mat &frame) = 0;
+  // Steps over the next frame without producing its pixels if possible.
+  [[nodiscard]] virtual bool grab() = 0;
+  // Makes the next read() return frame_i.
+  [[nodiscard]] virtual bool seek(int frame_i) = 0;
+};
+
+// A video file read with cv::VideoCapture.
+struct VideoSource final : FrameSource {
+  explicit VideoSource(const std::string &path);
+
+  [[nodiscard]] bool is_open() const override;
+  [[nodiscard]] int frame_count() const override;
+  [[nodiscard]] double fps() const override;
+  [[nodiscard]] bool random_access() const override;
+
+  [[nodiscard]] bool read(cv::Mat &frame) override;
+  [[nodiscard]] bool grab() override;
+  [[nodiscard]] bool seek(int frame_i) override;
+
+private:
+  cv::VideoCapture cap;
+};
+
+// Procedural frames: a fixed backdrop with cartoon faces moving over it and
+// the frame index printed in a corner. Frame i is the same on every run and
+// at any read order, at any resolution.
+struct SyntheticSource final : FrameSource {
+  SyntheticSource(int width, int height, int frame_count = 3000,
+                  double fps = 30, int face_count = 3);
+
+  [[nodiscard]] bool is_open() const override;
+  [[nodiscard]] int frame_count() const override;
+  [[nodiscard]] double fps() const override;
+  [[nodiscard]] bool random_access() const override;
+
+  [[nodiscard]] bool read(cv::Mat &frame) override;
+  [[nodiscard]] bool grab() override;
+  [[nodiscard]] bool seek(int frame_i) override;
+
+  void render(int frame_i, cv::Mat &frame) const;
+
+private:
+  cv::Mat backdrop;
+  int count;
+  double rate;
+  int face_count;
+  int next = 0;
+};
+
+// Opens "synthetic:<width>x<height>[:<frames>[:<fps>]]", a directory of
+// images or otherwise a video file. Check is_open() on the result.
+[[nodiscard]] auto open_frame_source(const std::string &uri)
+    -> std::unique_ptr<FrameSource>;
+
+// Whether uri names a file or directory, so indices can be stored next to it.
+[[nodiscard]] bool is_file_source(const std::string &uri);
+
+} // namespace btw
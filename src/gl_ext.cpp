@@ -0,0 +1,45 @@
+#include "gl_ext.h"
+
+#include <string_view>
+
+btw::gl_ext::BufferStorageProc btw::gl_ext::buffer_storage = nullptr;
+
+namespace {
+
+[[nodiscard]] bool has_extension(std::string_view name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const auto *extension =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension && name == extension) {
+      return true;
+    }
+  }
+  return false;
+}
+
+[[nodiscard]] bool has_version(GLint major, GLint minor) {
+  GLint context_major = 0;
+  GLint context_minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+  glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+  return context_major > major ||
+         (context_major == major && context_minor >= minor);
+}
+
+} // namespace
+
+void btw::gl_ext::load(GLADloadfunc load_proc) {
+  buffer_storage = nullptr;
+  if (has_version(4, 4) || has_extension("GL_ARB_buffer_storage")) {
+    buffer_storage =
+        reinterpret_cast<BufferStorageProc>(load_proc("glBufferStorage"));
+  }
+}
+
+bool btw::gl_ext::has_buffer_storage() { return buffer_storage != nullptr; }
+
+bool btw::gl_ext::has_timer_query() {
+  return GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+}
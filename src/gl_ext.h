@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// GL 4.4 / ARB_buffer_storage, which the bundled glad loader (GL 3.3) does
+// not cover.
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+namespace btw::gl_ext {
+
+using BufferStorageProc = void(GLAD_API_PTR *)(GLenum target, GLsizeiptr size,
+                                                const void *data,
+                                                GLbitfield flags);
+
+// Null when buffer storage is unavailable.
+extern BufferStorageProc buffer_storage;
+
+// Loads the extension entry points. Needs a current context and gladLoadGL.
+void load(GLADloadfunc load_proc);
+
+[[nodiscard]] bool has_buffer_storage();
+
+// GL 3.3 / ARB_timer_query, for GL_TIME_ELAPSED queries. The context asks for
+// 3.2, so this may be missing.
+[[nodiscard]] bool has_timer_query();
+
+} // namespace btw::gl_ext
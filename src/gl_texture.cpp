@@ -0,0 +1,209 @@
+#include "gl_texture.h"
+
+#include "gl_ext.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <tuple>
+
+namespace {
+
+// Copies the rows of image tightly packed into dst.
+void copy_rows(const cv::Mat &image, void *dst) {
+  const auto row_bytes = image.cols * image.elemSize();
+  if (image.isContinuous()) {
+    std::memcpy(dst, image.ptr(), row_bytes * image.rows);
+    return;
+  }
+  auto *out = static_cast<unsigned char *>(dst);
+  for (int r = 0; r < image.rows; ++r) {
+    std::memcpy(out + r * row_bytes, image.ptr(r), row_bytes);
+  }
+}
+
+} // namespace
+
+btw::GLTexture::GLTexture() {
+  BTW_TRACE_SCOPE("GLTexture::GLTexture");
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+
+  constexpr std::array params{std::tuple{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
+                              std::tuple{GL_TEXTURE_MAG_FILTER, GL_LINEAR},
+                              std::tuple{GL_TEXTURE_WRAP_S, GL_CLAMP},
+                              std::tuple{GL_TEXTURE_WRAP_T, GL_CLAMP}};
+
+  for (const auto &[p_name, p_value] : params) {
+    glTexParameteri(GL_TEXTURE_2D, p_name, p_value);
+  }
+}
+
+btw::GLTexture::GLTexture(const cv::Mat &image) : GLTexture() {
+  upload(image);
+}
+
+void btw::GLTexture::update(const cv::Mat &image, std::int64_t image_version) {
+  if (image_version == version) {
+    return;
+  }
+  upload(image);
+  version = image_version;
+}
+
+void btw::GLTexture::upload(const cv::Mat &image) {
+  BTW_TRACE_SCOPE("GLTexture::upload");
+  const auto start = std::chrono::steady_clock::now();
+
+  glBindTexture(GL_TEXTURE_2D, id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (image.cols != width || image.rows != height) {
+    width = image.cols;
+    height = image.rows;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR,
+                 GL_UNSIGNED_BYTE, nullptr);
+  }
+
+  if (upload_mode == UploadMode::persistent && upload_persistent(image)) {
+    last_upload_mode = UploadMode::persistent;
+  } else if (upload_mode != UploadMode::direct && upload_pbo(image)) {
+    last_upload_mode = UploadMode::pbo;
+  } else {
+    upload_direct(image);
+    last_upload_mode = UploadMode::direct;
+  }
+
+  last_upload_ms = std::chrono::duration<float, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+}
+
+void btw::GLTexture::upload_direct(const cv::Mat &image) {
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, image.step / image.elemSize());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGR,
+                  GL_UNSIGNED_BYTE, image.ptr());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+bool btw::GLTexture::upload_pbo(const cv::Mat &image) {
+  if (!GLAD_GL_VERSION_2_1) {
+    return false;
+  }
+  if (!pbos[0]) {
+    glGenBuffers(size(pbos), pbos.data());
+  }
+
+  const auto bytes = image.total() * image.elemSize();
+  pbo_i = (pbo_i + 1) % size(pbos);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[pbo_i]);
+
+  // Orphaning lets the driver hand out fresh storage instead of waiting for
+  // a transfer still reading the previous contents.
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  auto *const data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                      GL_MAP_WRITE_BIT |
+                                          GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!data) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+  copy_rows(image, data);
+  const bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  if (ok) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGR,
+                    GL_UNSIGNED_BYTE, nullptr);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return ok;
+}
+
+bool btw::GLTexture::upload_persistent(const cv::Mat &image) {
+  if (!gl_ext::has_buffer_storage()) {
+    return false;
+  }
+
+  const auto bytes = image.total() * image.elemSize();
+  if (persistent_slot_bytes < bytes) {
+    release_persistent();
+
+    constexpr GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &persistent_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, persistent_buffer);
+    gl_ext::buffer_storage(GL_PIXEL_UNPACK_BUFFER, bytes * persistent_slots,
+                           nullptr, flags);
+    persistent_data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                       bytes * persistent_slots, flags);
+    if (!persistent_data) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      release_persistent();
+      return false;
+    }
+    persistent_slot_bytes = bytes;
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, persistent_buffer);
+  }
+
+  persistent_i = (persistent_i + 1) % persistent_slots;
+  auto &fence = persistent_fences[persistent_i];
+  if (fence) {
+    // Only blocks if the GPU is still reading this slot from
+    // persistent_slots uploads ago.
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  const auto offset = persistent_i * persistent_slot_bytes;
+  copy_rows(image, static_cast<unsigned char *>(persistent_data) + offset);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGR,
+                  GL_UNSIGNED_BYTE, (const void *)offset);
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return true;
+}
+
+void btw::GLTexture::release_persistent() {
+  for (auto &fence : persistent_fences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (persistent_buffer) {
+    // Deleting a buffer also unmaps it.
+    glDeleteBuffers(1, &persistent_buffer);
+    persistent_buffer = 0;
+  }
+  persistent_data = nullptr;
+  persistent_slot_bytes = 0;
+}
+
+btw::GLTexture::~GLTexture() {
+  release_persistent();
+  if (pbos[0]) {
+    glDeleteBuffers(size(pbos), pbos.data());
+  }
+  if (id) {
+    glDeleteTextures(1, &id);
+  }
+}
+
+void ImGui::Image(const btw::GLTexture &texture) {
+
+  ImGui::Image((void *)(intptr_t)texture.id,
+               ImVec2(texture.width, texture.height));
+}
+
+void ImGui::Image(const btw::GLTexture &texture, const ImVec2 &uv0,
+                  const ImVec2 &uv1) {
+
+  ImGui::Image((void *)(intptr_t)texture.id,
+               ImVec2(texture.width * (uv1.x - uv0.x),
+                      texture.height * (uv1.y - uv0.y)),
+               uv0, uv1);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "imgui_opengl.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace btw {
+
+// A GL texture holding BGR cv::Mat pixels. The storage is kept across
+// update() calls so streaming frames only re-uploads changed content.
+struct GLTexture {
+  enum class UploadMode {
+    // glTexSubImage2D straight from the cv::Mat.
+    direct,
+    // Through a ring of orphaned pixel buffer objects, so the GPU transfer
+    // overlaps later work instead of blocking the upload call.
+    pbo,
+    // Through a fenced ring in one persistently mapped buffer (GL 4.4).
+    persistent,
+  };
+
+  GLuint id = 0;
+  int width = 0;
+  int height = 0;
+  // Identifies the pixels last uploaded by update(), -1 for none.
+  std::int64_t version = -1;
+
+  UploadMode upload_mode = UploadMode::direct;
+  // What the last upload actually used, after falling back when upload_mode
+  // is unavailable, and the CPU time it took.
+  UploadMode last_upload_mode = UploadMode::direct;
+  float last_upload_ms = 0;
+
+  GLTexture();
+  explicit GLTexture(const cv::Mat &image);
+
+  GLTexture(const GLTexture &) = delete;
+  GLTexture(GLTexture &&) = delete;
+  GLTexture &operator=(const GLTexture &) = delete;
+  GLTexture &operator=(GLTexture &&) = delete;
+
+  // Uploads image unless image_version matches the last upload. The storage
+  // is only reallocated when the image size changes.
+  void update(const cv::Mat &image, std::int64_t image_version);
+
+  ~GLTexture();
+
+private:
+  static constexpr int persistent_slots = 3;
+
+  void upload(const cv::Mat &image);
+  void upload_direct(const cv::Mat &image);
+  [[nodiscard]] bool upload_pbo(const cv::Mat &image);
+  [[nodiscard]] bool upload_persistent(const cv::Mat &image);
+  void release_persistent();
+
+  std::array<GLuint, 2> pbos{};
+  int pbo_i = 0;
+
+  GLuint persistent_buffer = 0;
+  void *persistent_data = nullptr;
+  std::size_t persistent_slot_bytes = 0;
+  std::array<GLsync, persistent_slots> persistent_fences{};
+  int persistent_i = 0;
+};
+
+} // namespace btw
+
+namespace ImGui {
+void Image(const btw::GLTexture &texture);
+
+// Draws the normalized sub-rectangle uv0..uv1 of texture at its pixel size,
+// without any extra texture or upload.
+void Image(const btw::GLTexture &texture, const ImVec2 &uv0,
+           const ImVec2 &uv1);
+} // namespace ImGui
@@ -0,0 +1,252 @@
+#include "image_sequence.h"
+#include "binary_io.h"
+#include "file_stamp.h"
+
+#include "opencv2/imgcodecs.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+namespace {
+
+constexpr std::array<char, 4> index_magic{'B', 'W', 'I', 'S'};
+constexpr std::uint32_t index_version = 1;
+
+[[nodiscard]] bool is_image(const std::filesystem::path &path) {
+  constexpr std::array extensions{".png", ".jpg",  ".jpeg", ".bmp",
+                                  ".tif", ".tiff", ".webp", ".ppm"};
+  auto extension = path.extension().string();
+  std::transform(begin(extension), end(extension), begin(extension),
+                 [](unsigned char c) { return std::tolower(c); });
+  return std::find(begin(extensions), end(extensions), extension) !=
+         end(extensions);
+}
+
+[[nodiscard]] bool is_digit(char c) {
+  return std::isdigit(static_cast<unsigned char>(c));
+}
+
+} // namespace
+
+bool btw::natural_less(const std::string &a, const std::string &b) {
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < size(a) && j < size(b)) {
+    if (!is_digit(a[i]) || !is_digit(b[j])) {
+      if (a[i] != b[j]) {
+        return a[i] < b[j];
+      }
+      ++i;
+      ++j;
+      continue;
+    }
+
+    // Compare digit runs by value: without leading zeros, the longer run is
+    // larger, and equal lengths compare lexicographically.
+    const auto run_end = [](const std::string &s, std::size_t k) {
+      while (k < size(s) && is_digit(s[k])) {
+        ++k;
+      }
+      return k;
+    };
+    const auto skip_zeros = [](const std::string &s, std::size_t k,
+                               std::size_t end) {
+      while (k + 1 < end && s[k] == '0') {
+        ++k;
+      }
+      return k;
+    };
+    const auto a_end = run_end(a, i);
+    const auto b_end = run_end(b, j);
+    const auto a_start = skip_zeros(a, i, a_end);
+    const auto b_start = skip_zeros(b, j, b_end);
+    if (a_end - a_start != b_end - b_start) {
+      return a_end - a_start < b_end - b_start;
+    }
+    const auto value_order =
+        a.compare(a_start, a_end - a_start, b, b_start, b_end - b_start);
+    if (value_order != 0) {
+      return value_order < 0;
+    }
+    i = a_end;
+    j = b_end;
+  }
+  return size(a) - i < size(b) - j;
+}
+
+auto btw::ImageSequenceIndex::path_for(const std::string &directory)
+    -> std::string {
+  return index_path(directory, ".seqidx");
+}
+
+auto btw::ImageSequenceIndex::build(const std::string &directory)
+    -> ImageSequenceIndex {
+  ImageSequenceIndex index;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    if (entry.is_regular_file() && is_image(entry.path())) {
+      index.names.push_back(entry.path().filename().string());
+    }
+  }
+  std::sort(begin(index.names), end(index.names), natural_less);
+  return index;
+}
+
+auto btw::ImageSequenceIndex::load(const std::string &directory)
+    -> std::optional<ImageSequenceIndex> {
+  const auto stamp = file_stamp(directory);
+  if (!stamp) {
+    return std::nullopt;
+  }
+
+  std::ifstream in(path_for(directory), std::ios::binary);
+
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  FileStamp stored_stamp;
+  std::uint32_t count;
+  if (!read_pod(in, magic) || magic != index_magic ||
+      !read_pod(in, version) || version != index_version ||
+      !read_pod(in, stored_stamp) || stored_stamp != *stamp ||
+      !read_pod(in, count) ||
+      // Each name takes at least its length.
+      static_cast<std::uint64_t>(count) * sizeof(std::uint32_t) >
+          static_cast<std::uint64_t>(remaining_bytes(in))) {
+    return std::nullopt;
+  }
+
+  ImageSequenceIndex index;
+  index.names.resize(count);
+  for (auto &name : index.names) {
+    std::uint32_t length;
+    if (!read_pod(in, length) || length > 4096) {
+      return std::nullopt;
+    }
+    name.resize(length);
+    if (!in.read(name.data(), length)) {
+      return std::nullopt;
+    }
+  }
+  return index;
+}
+
+bool btw::ImageSequenceIndex::save(const std::string &directory) const {
+  const auto stamp = file_stamp(directory);
+  if (!stamp) {
+    return false;
+  }
+
+  // Written aside and renamed over, as several sources may open the same
+  // directory at once.
+  const auto path = path_for(directory);
+  const auto temp_path = path + ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    write_pod(out, index_magic);
+    write_pod(out, index_version);
+    write_pod(out, *stamp);
+    write_pod(out, static_cast<std::uint32_t>(size(names)));
+    for (const auto &name : names) {
+      write_pod(out, static_cast<std::uint32_t>(size(name)));
+      out.write(name.data(), size(name));
+    }
+    if (!out) {
+      std::error_code error;
+      std::filesystem::remove(temp_path, error);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  return !error;
+}
+
+auto btw::ImageSequenceIndex::open(const std::string &directory)
+    -> ImageSequenceIndex {
+  if (auto index = load(directory)) {
+    return std::move(*index);
+  }
+  auto index = build(directory);
+  index.save(directory);
+  return index;
+}
+
+auto btw::read_image(const std::string &path) -> cv::Mat {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return {};
+  }
+  struct stat st {};
+  std::vector<unsigned char> bytes;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+    ::posix_fadvise(fd, 0, st.st_size, POSIX_FADV_SEQUENTIAL);
+    bytes.resize(st.st_size);
+    std::size_t done = 0;
+    while (done < size(bytes)) {
+      const auto got = ::read(fd, bytes.data() + done, size(bytes) - done);
+      if (got <= 0) {
+        break;
+      }
+      done += got;
+    }
+    bytes.resize(done);
+  }
+  ::close(fd);
+
+  if (bytes.empty()) {
+    return {};
+  }
+  return cv::imdecode(bytes, cv::IMREAD_COLOR);
+}
+
+btw::ImageSequenceSource::ImageSequenceSource(const std::string &directory,
+                                              double fps)
+    : directory(directory), index(ImageSequenceIndex::open(directory)),
+      rate(fps) {}
+
+bool btw::ImageSequenceSource::is_open() const {
+  return !index.names.empty();
+}
+
+int btw::ImageSequenceSource::frame_count() const {
+  return static_cast<int>(size(index.names));
+}
+
+double btw::ImageSequenceSource::fps() const { return rate; }
+
+bool btw::ImageSequenceSource::random_access() const { return true; }
+
+bool btw::ImageSequenceSource::read(cv::Mat &frame) {
+  if (next >= frame_count()) {
+    return false;
+  }
+  frame = read_image(
+      (std::filesystem::path(directory) / index.names[next++]).string());
+  return !frame.empty();
+}
+
+bool btw::ImageSequenceSource::grab() {
+  if (next >= frame_count()) {
+    return false;
+  }
+  ++next;
+  return true;
+}
+
+bool btw::ImageSequenceSource::seek(int frame_i) {
+  if (frame_i < 0 || frame_i >= frame_count()) {
+    return false;
+  }
+  next = frame_i;
+  return true;
+}
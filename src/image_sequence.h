@@ -0,0 +1,65 @@
+#pragma once
+
+#include "frame_source.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace btw {
+
+// Orders names with digit runs compared by value, so "frame_9.png" comes
+// before "frame_10.png".
+[[nodiscard]] bool natural_less(const std::string &a, const std::string &b);
+
+// The image file names of a directory in natural order. Listed once and
+// persisted next to the directory as "<directory>.seqidx", which is rebuilt
+// when the directory changes.
+struct ImageSequenceIndex {
+  std::vector<std::string> names;
+
+  [[nodiscard]] static auto path_for(const std::string &directory)
+      -> std::string;
+
+  [[nodiscard]] static auto build(const std::string &directory)
+      -> ImageSequenceIndex;
+
+  // Fails if the index is missing, corrupt or older than the directory.
+  [[nodiscard]] static auto load(const std::string &directory)
+      -> std::optional<ImageSequenceIndex>;
+
+  bool save(const std::string &directory) const;
+
+  // Loads the index, or builds and saves it.
+  [[nodiscard]] static auto open(const std::string &directory)
+      -> ImageSequenceIndex;
+};
+
+// Reads a whole file with one sequential read and decodes it with
+// cv::imdecode. An empty cv::Mat on failure.
+[[nodiscard]] auto read_image(const std::string &path) -> cv::Mat;
+
+// The images of a directory in natural order, one frame each. Every frame
+// is a separate file, so seeking is free.
+struct ImageSequenceSource final : FrameSource {
+  explicit ImageSequenceSource(const std::string &directory, double fps = 30);
+
+  [[nodiscard]] bool is_open() const override;
+  [[nodiscard]] int frame_count() const override;
+  [[nodiscard]] double fps() const override;
+  [[nodiscard]] bool random_access() const override;
+
+  [[nodiscard]] bool read(cv::Mat &frame) override;
+  [[nodiscard]] bool grab() override;
+  [[nodiscard]] bool seek(int frame_i) override;
+
+private:
+  std::string directory;
+  ImageSequenceIndex index;
+  double rate;
+  int next = 0;
+};
+
+} // namespace btw
@@ -30,6 +30,7 @@
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
+#include "trace.h"
 
 // GLFW
 #include <GLFW/glfw3.h>
@@ -238,6 +239,7 @@ static void ImGui_ImplGlfw_UpdateMouseCursor()
 
 void ImGui_ImplGlfw_NewFrame()
 {
+    BTW_TRACE_FUNCTION();
     ImGuiIO& io = ImGui::GetIO();
     IM_ASSERT(io.Fonts->IsBuilt());     // Font atlas needs to be built, call renderer _NewFrame() function e.g. ImGui_ImplOpenGL3_NewFrame() 
 
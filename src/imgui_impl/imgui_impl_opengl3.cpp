@@ -7,6 +7,9 @@
 
 // CHANGELOG 
 // (minor and older changes stripped away, please see git history for details)
+//  2026-10-17: OpenGL: Added owned-context mode (ImGui_ImplOpenGL3_SetOwnedContext): no GL state backup/restore, render state is shadowed and only changes are issued.
+//  2026-10-17: OpenGL: Added optional persistent-mapped ring streaming (ImGui_ImplOpenGL3_SetPersistentStreaming) and stream statistics.
+//  2026-10-17: OpenGL: Keep one VAO with the device objects instead of recreating it every frame. Upload all draw lists into one growing, orphaned vertex/index buffer pair and draw with base-vertex offsets.
 //  2018-06-08: Misc: Extracted imgui_impl_opengl3.cpp/.h away from the old combined GLFW/SDL+OpenGL3 examples.
 //  2018-06-08: OpenGL: Use draw_data->DisplayPos and draw_data->DisplaySize to setup projection matrix and clipping rectangle.
 //  2018-05-25: OpenGL: Removed unnecessary backup/restore of GL_ELEMENT_ARRAY_BUFFER_BINDING since this is part of the VAO state.
@@ -30,6 +33,9 @@
 //#include <GL/gl3w.h>    // This example is using gl3w to access OpenGL functions. You may freely use any other OpenGL loader such as: glew, glad, glLoadGen, etc.
 //#include <glew.h>
 #include <glad/glad.h>    // This example is using gl3w to access OpenGL functions. You may freely use any other OpenGL loader such as: glew, glad, glLoadGen, etc.
+#include "gl_ext.h"       // glBufferStorage, which glad's GL 3.3 profile lacks
+#include "trace.h"
+#include <chrono>
 
 // OpenGL Data
 static char         g_GlslVersion[32] = "";
@@ -37,7 +43,34 @@ static GLuint       g_FontTexture = 0;
 static int          g_ShaderHandle = 0, g_VertHandle = 0, g_FragHandle = 0;
 static int          g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;
 static int          g_AttribLocationPosition = 0, g_AttribLocationUV = 0, g_AttribLocationColor = 0;
-static unsigned int g_VboHandle = 0, g_ElementsHandle = 0;
+static unsigned int g_VboHandle = 0, g_ElementsHandle = 0, g_VaoHandle = 0;
+static GLsizeiptr   g_VboSize = 0, g_ElementsSize = 0;
+
+// Persistent-mapped streaming ring: g_RingSegments segments per buffer, each holding one frame and guarded by a fence.
+static const int    g_RingSegments = 3;
+static bool         g_PersistentRequested = false, g_PersistentActive = false;
+static unsigned int g_RingVao = 0, g_RingVbo = 0, g_RingElements = 0;
+static void*        g_RingVtxData = NULL;
+static void*        g_RingIdxData = NULL;
+static GLsizeiptr   g_RingVtxSegmentSize = 0, g_RingIdxSegmentSize = 0;
+static GLsync       g_RingFences[g_RingSegments] = {};
+static int          g_RingSegment = 0;
+static ImGui_ImplOpenGL3_StreamStats g_StreamStats = {};
+
+// Shadow of the render state set by this renderer, used to skip redundant GL calls.
+// In owned-context mode it is kept across frames. Otherwise the state is backed up and restored around every frame and the shadow is reset each time.
+struct ImGui_ImplOpenGL3_ShadowState
+{
+    GLuint      Program, VertexArray, Texture, Sampler;     // ~0u when unknown
+    int         Blend, CullFace, DepthTest, ScissorTest;    // -1 when unknown
+    bool        BlendFunc, PolygonFill;                     // Set to our values
+    GLint       Viewport[4], Scissor[4];
+    float       Projection[4];                              // L, R, T, B of the uploaded matrix
+};
+static bool         g_OwnedContext = false;
+static ImGui_ImplOpenGL3_ShadowState g_Shadow;
+
+static void ImGui_ImplOpenGL3_InvalidateShadowState();
 
 // Functions
 bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
@@ -48,6 +81,7 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
     IM_ASSERT((int)strlen(glsl_version) + 2 < IM_ARRAYSIZE(g_GlslVersion));
     strcpy(g_GlslVersion, glsl_version);
     strcat(g_GlslVersion, "\n");
+    ImGui_ImplOpenGL3_InvalidateShadowState();
     return true;
 }
 
@@ -58,15 +92,286 @@ void    ImGui_ImplOpenGL3_Shutdown()
 
 void    ImGui_ImplOpenGL3_NewFrame()
 {
+    BTW_TRACE_FUNCTION();
     if (!g_FontTexture)
         ImGui_ImplOpenGL3_CreateDeviceObjects();
 }
 
+void    ImGui_ImplOpenGL3_SetPersistentStreaming(bool enable)
+{
+    g_PersistentRequested = enable;
+}
+
+bool    ImGui_ImplOpenGL3_GetPersistentStreaming()
+{
+    return g_PersistentRequested;
+}
+
+bool    ImGui_ImplOpenGL3_IsPersistentStreaming()
+{
+    return g_PersistentActive;
+}
+
+void    ImGui_ImplOpenGL3_GetStreamStats(ImGui_ImplOpenGL3_StreamStats* out_stats)
+{
+    *out_stats = g_StreamStats;
+}
+
+void    ImGui_ImplOpenGL3_ResetStreamStats()
+{
+    g_StreamStats = ImGui_ImplOpenGL3_StreamStats();
+}
+
+void    ImGui_ImplOpenGL3_SetOwnedContext(bool owned)
+{
+    g_OwnedContext = owned;
+    ImGui_ImplOpenGL3_InvalidateShadowState();
+}
+
+bool    ImGui_ImplOpenGL3_IsOwnedContext()
+{
+    return g_OwnedContext;
+}
+
+static void ImGui_ImplOpenGL3_InvalidateShadowState()
+{
+    memset(&g_Shadow, 0xFF, sizeof(g_Shadow));     // Unknown values everywhere, NaN projection
+    g_Shadow.BlendFunc = g_Shadow.PolygonFill = false;
+}
+
+static void ImGui_ImplOpenGL3_SetCapability(GLenum cap, int* shadow, bool enable)
+{
+    if (*shadow == (int)enable)
+        return;
+    if (enable) glEnable(cap); else glDisable(cap);
+    *shadow = (int)enable;
+}
+
+static void ImGui_ImplOpenGL3_BindVertexArray(GLuint vao)
+{
+    if (g_Shadow.VertexArray == vao)
+        return;
+    glBindVertexArray(vao);
+    g_Shadow.VertexArray = vao;
+}
+
+static void ImGui_ImplOpenGL3_BindTexture(GLuint texture)
+{
+    if (g_Shadow.Texture == texture)
+        return;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    g_Shadow.Texture = texture;
+}
+
+static void ImGui_ImplOpenGL3_SetScissor(GLint x, GLint y, GLint w, GLint h)
+{
+    GLint* box = g_Shadow.Scissor;
+    if (box[0] == x && box[1] == y && box[2] == w && box[3] == h)
+        return;
+    glScissor(x, y, (GLsizei)w, (GLsizei)h);
+    box[0] = x; box[1] = y; box[2] = w; box[3] = h;
+}
+
+static void ImGui_ImplOpenGL3_SetupVertexArray(GLuint vao, GLuint vbo, GLuint elements)
+{
+    ImGui_ImplOpenGL3_BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elements);
+    glEnableVertexAttribArray(g_AttribLocationPosition);
+    glEnableVertexAttribArray(g_AttribLocationUV);
+    glEnableVertexAttribArray(g_AttribLocationColor);
+    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, pos));
+    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, uv));
+    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
+}
+
+static void ImGui_ImplOpenGL3_DestroyRing()
+{
+    for (int i = 0; i < g_RingSegments; i++)
+    {
+        if (g_RingFences[i]) glDeleteSync(g_RingFences[i]);
+        g_RingFences[i] = NULL;
+    }
+    if (g_RingVao) glDeleteVertexArrays(1, &g_RingVao);      // Unbinds it if bound
+    if (g_Shadow.VertexArray == g_RingVao) g_Shadow.VertexArray = (GLuint)~0u;
+    if (g_RingVbo) glDeleteBuffers(1, &g_RingVbo);             // Deleting a buffer also unmaps it
+    if (g_RingElements) glDeleteBuffers(1, &g_RingElements);
+    g_RingVao = g_RingVbo = g_RingElements = 0;
+    g_RingVtxData = g_RingIdxData = NULL;
+    g_RingVtxSegmentSize = g_RingIdxSegmentSize = 0;
+}
+
+static bool ImGui_ImplOpenGL3_CreateRing(GLsizeiptr vtx_segment_size, GLsizeiptr idx_segment_size)
+{
+    ImGui_ImplOpenGL3_DestroyRing();
+
+    // Whole vertices per segment so each segment starts at an integral base vertex
+    vtx_segment_size = (vtx_segment_size + sizeof(ImDrawVert) - 1) / sizeof(ImDrawVert) * sizeof(ImDrawVert);
+    // 4-byte aligned index segments, so every segment's index offset is aligned for ImDrawIdx
+    idx_segment_size = (idx_segment_size + 3) / 4 * 4;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &g_RingVbo);
+    glGenBuffers(1, &g_RingElements);
+    glBindBuffer(GL_ARRAY_BUFFER, g_RingVbo);
+    btw::gl_ext::buffer_storage(GL_ARRAY_BUFFER, vtx_segment_size * g_RingSegments, NULL, flags);
+    g_RingVtxData = glMapBufferRange(GL_ARRAY_BUFFER, 0, vtx_segment_size * g_RingSegments, flags);
+    glBindBuffer(GL_ARRAY_BUFFER, g_RingElements);
+    btw::gl_ext::buffer_storage(GL_ARRAY_BUFFER, idx_segment_size * g_RingSegments, NULL, flags);
+    g_RingIdxData = glMapBufferRange(GL_ARRAY_BUFFER, 0, idx_segment_size * g_RingSegments, flags);
+    if (!g_RingVtxData || !g_RingIdxData)
+    {
+        ImGui_ImplOpenGL3_DestroyRing();
+        return false;
+    }
+    g_RingVtxSegmentSize = vtx_segment_size;
+    g_RingIdxSegmentSize = idx_segment_size;
+
+    glGenVertexArrays(1, &g_RingVao);
+    ImGui_ImplOpenGL3_SetupVertexArray(g_RingVao, g_RingVbo, g_RingElements);
+    return true;
+}
+
+// Writes the frame into the next ring segment and binds the ring VAO. Outputs the base vertex and index byte offset of the segment.
+static bool ImGui_ImplOpenGL3_UploadPersistent(ImDrawData* draw_data, GLint* base_vertex, GLintptr* idx_base)
+{
+    const GLsizeiptr vtx_size = (GLsizeiptr)draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    if (!g_RingVao || vtx_size > g_RingVtxSegmentSize || idx_size > g_RingIdxSegmentSize)
+    {
+        const GLsizeiptr min_segment_size = 64 * 1024;
+        const GLsizeiptr vtx_segment_size = vtx_size + vtx_size / 2;
+        const GLsizeiptr idx_segment_size = idx_size + idx_size / 2;
+        if (!ImGui_ImplOpenGL3_CreateRing(vtx_segment_size > min_segment_size ? vtx_segment_size : min_segment_size, idx_segment_size > min_segment_size ? idx_segment_size : min_segment_size))
+        {
+            g_PersistentRequested = false; // Mapping failed, don't retry every frame
+            return false;
+        }
+    }
+
+    g_RingSegment = (g_RingSegment + 1) % g_RingSegments;
+    GLsync& fence = g_RingFences[g_RingSegment];
+    if (fence)
+    {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            g_StreamStats.FenceWaits++;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        fence = NULL;
+    }
+
+    char* vtx_dst = (char*)g_RingVtxData + g_RingSegment * g_RingVtxSegmentSize;
+    char* idx_dst = (char*)g_RingIdxData + g_RingSegment * g_RingIdxSegmentSize;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+        memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        vtx_dst += cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        idx_dst += cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+    }
+    g_StreamStats.BytesStreamed += vtx_size + idx_size;
+
+    *base_vertex = (GLint)(g_RingSegment * g_RingVtxSegmentSize / sizeof(ImDrawVert));
+    *idx_base = g_RingSegment * g_RingIdxSegmentSize;
+    ImGui_ImplOpenGL3_BindVertexArray(g_RingVao);
+    return true;
+}
+
+// Orphans and refills the buffer pair of the default VAO, and binds it.
+static void ImGui_ImplOpenGL3_UploadOrphaned(ImDrawData* draw_data)
+{
+    // The VAO is created with the device objects. VAOs are not shared among GL contexts, so the device objects must be (re)created on the context used for rendering.
+    ImGui_ImplOpenGL3_BindVertexArray(g_VaoHandle);
+
+    // Upload all command lists into one buffer pair. Orphaning the storage each frame lets the driver hand out fresh memory instead of waiting on the previous frame's draws; it is only reallocated when it must grow.
+    const GLsizeiptr vtx_size = (GLsizeiptr)draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    if (vtx_size > g_VboSize)
+        g_VboSize = vtx_size + vtx_size / 2;
+    if (idx_size > g_ElementsSize)
+        g_ElementsSize = idx_size + idx_size / 2;
+    glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
+    glBufferData(GL_ARRAY_BUFFER, g_VboSize, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, g_ElementsSize, NULL, GL_STREAM_DRAW);
+
+    GLintptr vtx_offset = 0, idx_offset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        const GLsizeiptr list_vtx_size = (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        const GLsizeiptr list_idx_size = (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        glBufferSubData(GL_ARRAY_BUFFER, vtx_offset, list_vtx_size, (const GLvoid*)cmd_list->VtxBuffer.Data);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, idx_offset, list_idx_size, (const GLvoid*)cmd_list->IdxBuffer.Data);
+        vtx_offset += list_vtx_size;
+        idx_offset += list_idx_size;
+    }
+    g_StreamStats.BytesStreamed += vtx_size + idx_size;
+}
+
+// GL state saved around a frame when the renderer doesn't own the context.
+struct ImGui_ImplOpenGL3_BackupState
+{
+    GLenum      ActiveTexture;
+    GLint       Program, Texture, Sampler, ArrayBuffer, VertexArray;
+    GLint       PolygonMode[2], Viewport[4], ScissorBox[4];
+    GLenum      BlendSrcRgb, BlendDstRgb, BlendSrcAlpha, BlendDstAlpha, BlendEquationRgb, BlendEquationAlpha;
+    GLboolean   EnableBlend, EnableCullFace, EnableDepthTest, EnableScissorTest;
+};
+
+static void ImGui_ImplOpenGL3_BackupGLState(ImGui_ImplOpenGL3_BackupState* b)
+{
+    glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&b->ActiveTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &b->Program);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &b->Texture);
+    glGetIntegerv(GL_SAMPLER_BINDING, &b->Sampler);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &b->ArrayBuffer);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &b->VertexArray);
+    glGetIntegerv(GL_POLYGON_MODE, b->PolygonMode);
+    glGetIntegerv(GL_VIEWPORT, b->Viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, b->ScissorBox);
+    glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&b->BlendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&b->BlendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&b->BlendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&b->BlendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&b->BlendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&b->BlendEquationAlpha);
+    b->EnableBlend = glIsEnabled(GL_BLEND);
+    b->EnableCullFace = glIsEnabled(GL_CULL_FACE);
+    b->EnableDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    b->EnableScissorTest = glIsEnabled(GL_SCISSOR_TEST);
+}
+
+static void ImGui_ImplOpenGL3_RestoreGLState(const ImGui_ImplOpenGL3_BackupState* b)
+{
+    glUseProgram(b->Program);
+    glBindTexture(GL_TEXTURE_2D, b->Texture);
+    if (glBindSampler) glBindSampler(0, b->Sampler);
+    glActiveTexture(b->ActiveTexture);
+    glBindVertexArray(b->VertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, b->ArrayBuffer);
+    glBlendEquationSeparate(b->BlendEquationRgb, b->BlendEquationAlpha);
+    glBlendFuncSeparate(b->BlendSrcRgb, b->BlendDstRgb, b->BlendSrcAlpha, b->BlendDstAlpha);
+    if (b->EnableBlend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    if (b->EnableCullFace) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    if (b->EnableDepthTest) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+    if (b->EnableScissorTest) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, (GLenum)b->PolygonMode[0]);
+    glViewport(b->Viewport[0], b->Viewport[1], (GLsizei)b->Viewport[2], (GLsizei)b->Viewport[3]);
+    glScissor(b->ScissorBox[0], b->ScissorBox[1], (GLsizei)b->ScissorBox[2], (GLsizei)b->ScissorBox[3]);
+}
+
 // OpenGL3 Render function.
 // (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
 // Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly, in order to be able to run within any OpenGL engine that doesn't do so. 
+// In owned-context mode nothing is saved or restored and only state that differs from the previous frame is set.
 void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 {
+    BTW_TRACE_FUNCTION();
     // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
     ImGuiIO& io = ImGui::GetIO();
     int fb_width = (int)(draw_data->DisplaySize.x * io.DisplayFramebufferScale.x);
@@ -74,82 +379,91 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
     if (fb_width <= 0 || fb_height <= 0)
         return;
     draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+    const std::chrono::steady_clock::time_point render_start = std::chrono::steady_clock::now();
 
-    // Backup GL state
-    GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
-    glActiveTexture(GL_TEXTURE0);
-    GLint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-    GLint last_texture; glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-    GLint last_sampler; glGetIntegerv(GL_SAMPLER_BINDING, &last_sampler);
-    GLint last_array_buffer; glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
-    GLint last_vertex_array; glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
-    GLint last_polygon_mode[2]; glGetIntegerv(GL_POLYGON_MODE, last_polygon_mode);
-    GLint last_viewport[4]; glGetIntegerv(GL_VIEWPORT, last_viewport);
-    GLint last_scissor_box[4]; glGetIntegerv(GL_SCISSOR_BOX, last_scissor_box);
-    GLenum last_blend_src_rgb; glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&last_blend_src_rgb);
-    GLenum last_blend_dst_rgb; glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&last_blend_dst_rgb);
-    GLenum last_blend_src_alpha; glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint*)&last_blend_src_alpha);
-    GLenum last_blend_dst_alpha; glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint*)&last_blend_dst_alpha);
-    GLenum last_blend_equation_rgb; glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint*)&last_blend_equation_rgb);
-    GLenum last_blend_equation_alpha; glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint*)&last_blend_equation_alpha);
-    GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
-    GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
-    GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
-    GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    // Backup GL state. An owned context only holds what this renderer set last frame, except for the state the application itself
+    // changes between frames: the bound texture (user textures are created and updated outside of the renderer), the viewport and the scissor test.
+    ImGui_ImplOpenGL3_BackupState backup;
+    if (g_OwnedContext)
+    {
+        g_Shadow.Texture = (GLuint)~0u;
+        g_Shadow.Viewport[0] = -1;
+        g_Shadow.ScissorTest = -1;
+    }
+    else
+    {
+        ImGui_ImplOpenGL3_BackupGLState(&backup);
+        ImGui_ImplOpenGL3_InvalidateShadowState();
+    }
 
     // Setup render state: alpha-blending enabled, no face culling, no depth testing, scissor enabled, polygon fill
-    glEnable(GL_BLEND);
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_SCISSOR_TEST);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    ImGui_ImplOpenGL3_SetCapability(GL_BLEND, &g_Shadow.Blend, true);
+    if (!g_Shadow.BlendFunc)
+    {
+        glBlendEquation(GL_FUNC_ADD);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        g_Shadow.BlendFunc = true;
+    }
+    ImGui_ImplOpenGL3_SetCapability(GL_CULL_FACE, &g_Shadow.CullFace, false);
+    ImGui_ImplOpenGL3_SetCapability(GL_DEPTH_TEST, &g_Shadow.DepthTest, false);
+    ImGui_ImplOpenGL3_SetCapability(GL_SCISSOR_TEST, &g_Shadow.ScissorTest, true);
+    if (!g_Shadow.PolygonFill)
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        g_Shadow.PolygonFill = true;
+    }
 
     // Setup viewport, orthographic projection matrix
     // Our visible imgui space lies from draw_data->DisplayPps (top left) to draw_data->DisplayPos+data_data->DisplaySize (bottom right). DisplayMin is typically (0,0) for single viewport apps.
-    glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
+    GLint* viewport = g_Shadow.Viewport;
+    if (viewport[0] != 0 || viewport[1] != 0 || viewport[2] != fb_width || viewport[3] != fb_height)
+    {
+        glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
+        viewport[0] = 0; viewport[1] = 0; viewport[2] = fb_width; viewport[3] = fb_height;
+    }
     float L = draw_data->DisplayPos.x;
     float R = draw_data->DisplayPos.x + draw_data->DisplaySize.x;
     float T = draw_data->DisplayPos.y;
     float B = draw_data->DisplayPos.y + draw_data->DisplaySize.y;
-    const float ortho_projection[4][4] =
+    if (g_Shadow.Program != (GLuint)g_ShaderHandle)
     {
-        { 2.0f/(R-L),   0.0f,         0.0f,   0.0f },
-        { 0.0f,         2.0f/(T-B),   0.0f,   0.0f },
-        { 0.0f,         0.0f,        -1.0f,   0.0f },
-        { (R+L)/(L-R),  (T+B)/(B-T),  0.0f,   1.0f },
-    };
-    glUseProgram(g_ShaderHandle);
-    glUniform1i(g_AttribLocationTex, 0);
-    glUniformMatrix4fv(g_AttribLocationProjMtx, 1, GL_FALSE, &ortho_projection[0][0]);
-    if (glBindSampler) glBindSampler(0, 0); // We use combined texture/sampler state. Applications using GL 3.3 may set that otherwise.
-
-    // Recreate the VAO every time 
-    // (This is to easily allow multiple GL contexts. VAO are not shared among GL contexts, and we don't track creation/deletion of windows so we don't have an obvious key to use to cache them.)
-    GLuint vao_handle = 0;
-    glGenVertexArrays(1, &vao_handle);
-    glBindVertexArray(vao_handle);
-    glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-    glEnableVertexAttribArray(g_AttribLocationPosition);
-    glEnableVertexAttribArray(g_AttribLocationUV);
-    glEnableVertexAttribArray(g_AttribLocationColor);
-    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, pos));
-    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, uv));
-    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
+        glUseProgram(g_ShaderHandle);
+        glUniform1i(g_AttribLocationTex, 0);
+        g_Shadow.Program = (GLuint)g_ShaderHandle;
+    }
+    float* projection = g_Shadow.Projection;
+    if (projection[0] != L || projection[1] != R || projection[2] != T || projection[3] != B)   // Uniforms live in the program object, so they survive across frames
+    {
+        const float ortho_projection[4][4] =
+        {
+            { 2.0f/(R-L),   0.0f,         0.0f,   0.0f },
+            { 0.0f,         2.0f/(T-B),   0.0f,   0.0f },
+            { 0.0f,         0.0f,        -1.0f,   0.0f },
+            { (R+L)/(L-R),  (T+B)/(B-T),  0.0f,   1.0f },
+        };
+        glUniformMatrix4fv(g_AttribLocationProjMtx, 1, GL_FALSE, &ortho_projection[0][0]);
+        projection[0] = L; projection[1] = R; projection[2] = T; projection[3] = B;
+    }
+    if (glBindSampler && g_Shadow.Sampler != 0) // We use combined texture/sampler state. Applications using GL 3.3 may set that otherwise.
+    {
+        glBindSampler(0, 0);
+        g_Shadow.Sampler = 0;
+    }
+
+    GLint base_vertex = 0;
+    GLintptr idx_base = 0;
+    if (g_PersistentRequested && !btw::gl_ext::has_buffer_storage())
+        g_PersistentRequested = false; // Unsupported, report it as off
+    g_PersistentActive = g_PersistentRequested && ImGui_ImplOpenGL3_UploadPersistent(draw_data, &base_vertex, &idx_base);
+    if (!g_PersistentActive)
+        ImGui_ImplOpenGL3_UploadOrphaned(draw_data);
 
     // Draw
     ImVec2 pos = draw_data->DisplayPos;
+    const ImDrawIdx* idx_buffer_offset = (const ImDrawIdx*)idx_base;
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        const ImDrawIdx* idx_buffer_offset = 0;
-
-        glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
@@ -165,34 +479,26 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
                 if (clip_rect.x < fb_width && clip_rect.y < fb_height && clip_rect.z >= 0.0f && clip_rect.w >= 0.0f)
                 {
                     // Apply scissor/clipping rectangle
-                    glScissor((int)clip_rect.x, (int)(fb_height - clip_rect.w), (int)(clip_rect.z - clip_rect.x), (int)(clip_rect.w - clip_rect.y));
+                    ImGui_ImplOpenGL3_SetScissor((int)clip_rect.x, (int)(fb_height - clip_rect.w), (int)(clip_rect.z - clip_rect.x), (int)(clip_rect.w - clip_rect.y));
 
                     // Bind texture, Draw
-                    glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->TextureId);
-                    glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, idx_buffer_offset);
+                    ImGui_ImplOpenGL3_BindTexture((GLuint)(intptr_t)pcmd->TextureId);
+                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, idx_buffer_offset, base_vertex);
                 }
             }
             idx_buffer_offset += pcmd->ElemCount;
         }
+        base_vertex += cmd_list->VtxBuffer.Size;
     }
-    glDeleteVertexArrays(1, &vao_handle);
+    if (g_PersistentActive)
+        g_RingFences[g_RingSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
     // Restore modified GL state
-    glUseProgram(last_program);
-    glBindTexture(GL_TEXTURE_2D, last_texture);
-    if (glBindSampler) glBindSampler(0, last_sampler);
-    glActiveTexture(last_active_texture);
-    glBindVertexArray(last_vertex_array);
-    glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
-    glBlendEquationSeparate(last_blend_equation_rgb, last_blend_equation_alpha);
-    glBlendFuncSeparate(last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha);
-    if (last_enable_blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
-    if (last_enable_cull_face) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
-    if (last_enable_depth_test) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
-    if (last_enable_scissor_test) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
-    glPolygonMode(GL_FRONT_AND_BACK, (GLenum)last_polygon_mode[0]);
-    glViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
-    glScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
+    if (!g_OwnedContext)
+        ImGui_ImplOpenGL3_RestoreGLState(&backup);
+
+    g_StreamStats.Frames++;
+    g_StreamStats.RenderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count();
 }
 
 bool ImGui_ImplOpenGL3_CreateFontsTexture()
@@ -288,6 +594,10 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 
     glGenBuffers(1, &g_VboHandle);
     glGenBuffers(1, &g_ElementsHandle);
+    g_VboSize = g_ElementsSize = 0;
+
+    glGenVertexArrays(1, &g_VaoHandle);
+    ImGui_ImplOpenGL3_SetupVertexArray(g_VaoHandle, g_VboHandle, g_ElementsHandle);
 
     ImGui_ImplOpenGL3_CreateFontsTexture();
 
@@ -295,12 +605,16 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
     glBindTexture(GL_TEXTURE_2D, last_texture);
     glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
     glBindVertexArray(last_vertex_array);
+    ImGui_ImplOpenGL3_InvalidateShadowState();
 
     return true;
 }
 
 void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
 {
+    ImGui_ImplOpenGL3_DestroyRing();
+    if (g_VaoHandle) glDeleteVertexArrays(1, &g_VaoHandle);
+    g_VaoHandle = 0;
     if (g_VboHandle) glDeleteBuffers(1, &g_VboHandle);
     if (g_ElementsHandle) glDeleteBuffers(1, &g_ElementsHandle);
     g_VboHandle = g_ElementsHandle = 0;
@@ -315,6 +629,7 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
 
     if (g_ShaderHandle) glDeleteProgram(g_ShaderHandle);
     g_ShaderHandle = 0;
+    ImGui_ImplOpenGL3_InvalidateShadowState();   // Deleted names may be reused by new objects
 
     ImGui_ImplOpenGL3_DestroyFontsTexture();
 }
@@ -19,3 +19,26 @@ IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
+
+// Vertex/index streaming. By default every frame orphans and refills one buffer pair (glBufferData with GL_STREAM_DRAW).
+// With persistent streaming enabled, frames are written into a fenced, persistently mapped, triple-buffered ring instead.
+// This needs GL 4.4 or ARB_buffer_storage; without it the renderer keeps using the default path.
+struct ImGui_ImplOpenGL3_StreamStats
+{
+    unsigned long long  BytesStreamed;  // Vertex and index bytes written
+    unsigned int        FenceWaits;     // Frames that blocked until the GPU released a ring segment
+    unsigned int        Frames;
+    double              RenderMs;       // CPU time spent in ImGui_ImplOpenGL3_RenderDrawData
+};
+
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetPersistentStreaming(bool enable);
+IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_GetPersistentStreaming();    // The request, cleared when the ring is unsupported or can't be mapped
+IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_IsPersistentStreaming();     // Whether the last frame actually used the ring
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_GetStreamStats(ImGui_ImplOpenGL3_StreamStats* out_stats);
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_ResetStreamStats();
+
+// Owned context. By default every frame backs up the GL state it touches and restores it afterwards, so the renderer can be embedded in any GL engine.
+// When the application guarantees that only it and the renderer use the context, it can turn this off: render state is then kept in a shadow cache
+// and only calls that change it are issued. The application must not rely on the state being restored, e.g. the scissor test stays enabled.
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetOwnedContext(bool owned);
+IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_IsOwnedContext();
@@ -1,12 +1,54 @@
 #include "imgui_opengl.h"
+#include "gl_ext.h"
 #include <iostream>
+#include <optional>
 
 static void glfw_error_callback(int error, const char *description) {
   std::cerr << "Glfw Error " << error << ':' << description << '\n';
 }
 
+static void mark_activity(GLFWwindow *window) {
+  static_cast<btw::ImguiContext_glfw_opengl *>(glfwGetWindowUserPointer(window))
+      ->activity = true;
+}
+
+// ImGui's own callbacks, chained so any input also marks activity.
+static void install_callbacks(GLFWwindow *window) {
+  glfwSetMouseButtonCallback(
+      window, [](GLFWwindow *w, int button, int action, int mods) {
+        ImGui_ImplGlfw_MouseButtonCallback(w, button, action, mods);
+        mark_activity(w);
+      });
+  glfwSetScrollCallback(window, [](GLFWwindow *w, double x, double y) {
+    ImGui_ImplGlfw_ScrollCallback(w, x, y);
+    mark_activity(w);
+  });
+  glfwSetKeyCallback(
+      window, [](GLFWwindow *w, int key, int scancode, int action, int mods) {
+        ImGui_ImplGlfw_KeyCallback(w, key, scancode, action, mods);
+        mark_activity(w);
+      });
+  glfwSetCharCallback(window, [](GLFWwindow *w, unsigned int c) {
+    ImGui_ImplGlfw_CharCallback(w, c);
+    mark_activity(w);
+  });
+
+  glfwSetCursorPosCallback(
+      window, [](GLFWwindow *w, double, double) { mark_activity(w); });
+  glfwSetCursorEnterCallback(window,
+                             [](GLFWwindow *w, int) { mark_activity(w); });
+  glfwSetWindowFocusCallback(window,
+                             [](GLFWwindow *w, int) { mark_activity(w); });
+  glfwSetFramebufferSizeCallback(
+      window, [](GLFWwindow *w, int, int) { mark_activity(w); });
+  glfwSetWindowRefreshCallback(window,
+                               [](GLFWwindow *w) { mark_activity(w); });
+}
+
 btw::ImguiContext_glfw_opengl::ImguiContext_glfw_opengl(int width, int height,
-                                                        const char *win_name) {
+                                                        const char *win_name,
+                                                        bool headless)
+    : headless(headless) {
   glfwSetErrorCallback(glfw_error_callback);
   if (!glfwInit()) {
     exit(1);
@@ -14,21 +56,52 @@ btw::ImguiContext_glfw_opengl::ImguiContext_glfw_opengl(int width, int height,
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
   window = glfwCreateWindow(width, height, win_name, nullptr, nullptr);
+  if (!window) {
+    exit(1);
+  }
+  glfwSetWindowUserPointer(window, this);
 
   glfwMakeContextCurrent(window);
-  glfwSwapInterval(1);
+  glfwSwapInterval(headless ? 0 : 1);
 
   gladLoadGL((GLADloadfunc)glfwGetProcAddress);
+  btw::gl_ext::load((GLADloadfunc)glfwGetProcAddress);
+
+  if (headless) {
+    int fb_width;
+    int fb_height;
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+    glGenRenderbuffers(1, &color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fb_width, fb_height);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, color_buffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "headless framebuffer incomplete\n";
+      exit(1);
+    }
+  }
 
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForOpenGL(window, true);
+  ImGui_ImplGlfw_InitForOpenGL(window, false);
+  install_callbacks(window);
   ImGui_ImplOpenGL3_Init();
 }
 
-void btw::ImguiContext_glfw_opengl::render(ImVec4 clear_color) {
-  ImGui::Render();
+void btw::ImguiContext_glfw_opengl::render(ImVec4 clear_color,
+                                           Profiler *profiler) {
+  {
+    std::optional<CpuScope> scope;
+    if (profiler) {
+      scope.emplace(*profiler, Stage::imgui_render);
+    }
+    ImGui::Render();
+  }
   glfwMakeContextCurrent(window);
 
   const auto [display_w, display_h] = [&] {
@@ -38,15 +111,46 @@ void btw::ImguiContext_glfw_opengl::render(ImVec4 clear_color) {
     return std::tuple{display_w, display_h};
   }();
 
+  if (headless) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  }
+
   const auto [x, y, z, w] = clear_color;
+  if (is_owned_context()) {
+    // The renderer leaves scissoring on, which would clip the clear.
+    glDisable(GL_SCISSOR_TEST);
+  }
   glViewport(0, 0, display_w, display_h);
   glClearColor(x, y, z, w);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  {
+    std::optional<GpuScope> scope;
+    if (profiler) {
+      scope.emplace(*profiler, Stage::draw_data);
+    }
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  }
 
   glfwMakeContextCurrent(window);
-  glfwSwapBuffers(window);
+  if (headless) {
+    // Nothing presents, so nothing throttles the CPU either: wait for the
+    // frame instead of queueing GPU work without bound.
+    glFinish();
+  } else {
+    glfwSwapBuffers(window);
+  }
+  if (profiler) {
+    profiler->end_frame();
+  }
+}
+
+void btw::ImguiContext_glfw_opengl::set_owned_context(bool owned) {
+  ImGui_ImplOpenGL3_SetOwnedContext(owned);
+}
+
+bool btw::ImguiContext_glfw_opengl::is_owned_context() const {
+  return ImGui_ImplOpenGL3_IsOwnedContext();
 }
 
 bool btw::ImguiContext_glfw_opengl::is_window_open() const {
@@ -60,7 +164,26 @@ void btw::ImguiContext_glfw_opengl::start_frame() {
   glfwPollEvents();
 }
 
+void btw::ImguiContext_glfw_opengl::wait_events(double timeout) {
+  if (!activity) {
+    glfwWaitEventsTimeout(timeout);
+  }
+}
+
+bool btw::ImguiContext_glfw_opengl::take_activity() {
+  return activity.exchange(false);
+}
+
+void btw::ImguiContext_glfw_opengl::wake() {
+  activity = true;
+  glfwPostEmptyEvent();
+}
+
 btw::ImguiContext_glfw_opengl::~ImguiContext_glfw_opengl() {
+  if (fbo) {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color_buffer);
+  }
   glfwDestroyWindow(window);
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
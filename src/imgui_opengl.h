@@ -7,15 +7,25 @@
 #include "imgui.h"
 #include "imgui_impl/imgui_impl_glfw.h"
 #include "imgui_impl/imgui_impl_opengl3.h"
+#include "profiler.h"
 
+#include <atomic>
 #include <tuple>
 
 namespace btw {
 
 struct ImguiContext_glfw_opengl {
   GLFWwindow *window = nullptr;
+  // Headless contexts use an invisible window and render into fbo with no
+  // swap interval, so nothing is vsync-capped or needs a display.
+  bool headless = false;
+  GLuint fbo = 0;
+  GLuint color_buffer = 0;
+  // Set by input and window events and by wake(), cleared by take_activity().
+  std::atomic<bool> activity = true;
 
-  ImguiContext_glfw_opengl(int width, int height, const char *win_name);
+  ImguiContext_glfw_opengl(int width, int height, const char *win_name,
+                           bool headless = false);
 
   ImguiContext_glfw_opengl(const ImguiContext_glfw_opengl &) = delete;
   ImguiContext_glfw_opengl(ImguiContext_glfw_opengl &&) = delete;
@@ -24,11 +34,25 @@ struct ImguiContext_glfw_opengl {
 
   ImguiContext_glfw_opengl &operator=(ImguiContext_glfw_opengl &&) = delete;
 
-  void render(ImVec4 clear_color);
+  // Times ImGui::Render and the draw data submission into profiler when
+  // given.
+  void render(ImVec4 clear_color, Profiler *profiler = nullptr);
+
+  // In owned mode the renderer assumes nothing else touches the GL state and
+  // skips its per-frame backup/restore. Off by default.
+  void set_owned_context(bool owned);
+  bool is_owned_context() const;
 
   bool is_window_open() const;
 
   void start_frame();
+
+  // Blocks until an event arrives, wake() is called or timeout seconds pass.
+  void wait_events(double timeout);
+  [[nodiscard]] bool take_activity();
+  // Marks activity and interrupts wait_events(). Callable from any thread.
+  void wake();
+
   ~ImguiContext_glfw_opengl();
 };
 } // namespace btw
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+
+namespace btw {
+
+// Writes s as a quoted JSON string, escaping quotes, backslashes and control
+// characters.
+inline void write_json_string(std::ostream &out, std::string_view s) {
+  out << '"';
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+} // namespace btw
@@ -0,0 +1,155 @@
+#include "keyframe_index.h"
+#include "binary_io.h"
+#include "file_stamp.h"
+
+#include "opencv2/core/version.hpp"
+#include "opencv2/videoio.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+constexpr std::array<char, 4> index_magic{'B', 'W', 'K', 'F'};
+constexpr std::uint32_t index_version = 1;
+
+// Decoding a frame is the unit of cost; a seek also flushes the decoder and
+// re-reads the container, which costs roughly this many frames.
+constexpr int seek_penalty = 2;
+// Forward distance decoded instead of seeking when there is no index.
+constexpr int max_blind_forward = 8;
+
+} // namespace
+
+auto btw::KeyframeIndex::path_for(const std::string &video_path)
+    -> std::string {
+  return index_path(video_path, ".kfidx");
+}
+
+auto btw::KeyframeIndex::build(const std::string &video_path,
+                               std::stop_token stop)
+    -> std::optional<KeyframeIndex> {
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+  // CAP_PROP_FORMAT -1 makes grab() only demux, and exposes whether the last
+  // raw packet holds a keyframe.
+  cv::VideoCapture cap(video_path, cv::CAP_FFMPEG,
+                       std::vector{cv::CAP_PROP_FORMAT, -1});
+  if (!cap.isOpened()) {
+    return std::nullopt;
+  }
+
+  KeyframeIndex index;
+  for (int frame_i = 0; cap.grab(); ++frame_i) {
+    if (stop.stop_requested()) {
+      return std::nullopt;
+    }
+    if (cap.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0) {
+      index.keyframes.push_back(frame_i);
+    }
+  }
+
+  if (index.empty() || index.keyframes.front() != 0) {
+    return std::nullopt;
+  }
+  return index;
+#else
+  static_cast<void>(video_path);
+  static_cast<void>(stop);
+  return std::nullopt;
+#endif
+}
+
+auto btw::KeyframeIndex::load(const std::string &video_path)
+    -> std::optional<KeyframeIndex> {
+  const auto stamp = file_stamp(video_path);
+  if (!stamp) {
+    return std::nullopt;
+  }
+
+  std::ifstream in(path_for(video_path), std::ios::binary);
+
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  FileStamp stored_stamp;
+  std::uint32_t count;
+  if (!read_pod(in, magic) || magic != index_magic ||
+      !read_pod(in, version) || version != index_version ||
+      !read_pod(in, stored_stamp) || stored_stamp != *stamp ||
+      !read_pod(in, count) ||
+      static_cast<std::uint64_t>(count) * sizeof(int) >
+          static_cast<std::uint64_t>(remaining_bytes(in))) {
+    return std::nullopt;
+  }
+
+  KeyframeIndex index;
+  index.keyframes.resize(count);
+  if (!in.read(reinterpret_cast<char *>(index.keyframes.data()),
+               count * sizeof(int)) ||
+      !std::is_sorted(begin(index.keyframes), end(index.keyframes))) {
+    return std::nullopt;
+  }
+  return index;
+}
+
+bool btw::KeyframeIndex::save(const std::string &video_path) const {
+  const auto stamp = file_stamp(video_path);
+  if (!stamp) {
+    return false;
+  }
+
+  std::ofstream out(path_for(video_path), std::ios::binary | std::ios::trunc);
+  write_pod(out, index_magic);
+  write_pod(out, index_version);
+  write_pod(out, *stamp);
+  write_pod(out, static_cast<std::uint32_t>(size(keyframes)));
+  out.write(reinterpret_cast<const char *>(keyframes.data()),
+            size(keyframes) * sizeof(int));
+  return static_cast<bool>(out);
+}
+
+bool btw::KeyframeIndex::empty() const { return keyframes.empty(); }
+
+int btw::KeyframeIndex::keyframe_before(int frame_i) const {
+  const auto it =
+      std::upper_bound(begin(keyframes), end(keyframes), frame_i);
+  return it == begin(keyframes) ? 0 : *std::prev(it);
+}
+
+auto btw::plan_seek(const KeyframeIndex &index, int next_read, int target)
+    -> SeekPlan {
+  const bool can_forward = next_read >= 0 && next_read <= target;
+  const int forward_cost = target - next_read;
+
+  if (index.empty()) {
+    if (can_forward && forward_cost <= max_blind_forward) {
+      return {-1, forward_cost};
+    }
+    return {target, 0};
+  }
+
+  const int keyframe = index.keyframe_before(target);
+  const int seek_cost = target - keyframe + seek_penalty;
+
+  if (can_forward && forward_cost <= seek_cost) {
+    return {-1, forward_cost};
+  }
+  return {keyframe, target - keyframe};
+}
+
+bool btw::seek_and_read(FrameSource &source, const KeyframeIndex &index,
+                        int &next_read, int target, cv::Mat &frame) {
+  const auto [seek_to, skip_count] =
+      source.random_access()
+          ? SeekPlan{next_read == target ? -1 : target, 0}
+          : plan_seek(index, next_read, target);
+  bool ok = seek_to < 0 || source.seek(seek_to);
+  for (int i = 0; ok && i < skip_count; ++i) {
+    ok = source.grab();
+  }
+  ok = ok && source.read(frame);
+  next_read = ok ? target + 1 : -1;
+  return ok;
+}
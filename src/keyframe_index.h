@@ -0,0 +1,58 @@
+#pragma once
+
+#include "frame_source.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+namespace btw {
+
+// Frame indices of the keyframes of a video. Built once by demuxing the
+// packets (no decoding) and persisted next to the video as "<video>.kfidx".
+struct KeyframeIndex {
+  std::vector<int> keyframes;
+
+  [[nodiscard]] static auto path_for(const std::string &video_path)
+      -> std::string;
+
+  [[nodiscard]] static auto build(const std::string &video_path,
+                                  std::stop_token stop = {})
+      -> std::optional<KeyframeIndex>;
+
+  // Fails if the index is missing, corrupt or older than the video.
+  [[nodiscard]] static auto load(const std::string &video_path)
+      -> std::optional<KeyframeIndex>;
+
+  bool save(const std::string &video_path) const;
+
+  [[nodiscard]] bool empty() const;
+
+  // Last keyframe at or before frame_i.
+  [[nodiscard]] int keyframe_before(int frame_i) const;
+};
+
+struct SeekPlan {
+  // Frame to seek the capture to, or -1 to keep decoding from where it is.
+  int seek_to = -1;
+  // Frames to decode and drop before the target frame is read.
+  int skip_count = 0;
+};
+
+// Picks the cheaper of decoding forward from next_read (the frame the
+// capture returns next, -1 if unknown) and seeking to the keyframe before
+// target. Without an index, short forward steps decode and anything else
+// seeks straight to target.
+[[nodiscard]] auto plan_seek(const KeyframeIndex &index, int next_read,
+                             int target) -> SeekPlan;
+
+// Reads frame target from source following plan_seek, and updates
+// next_read. Random-access sources seek straight to target.
+[[nodiscard]] bool seek_and_read(FrameSource &source,
+                                 const KeyframeIndex &index, int &next_read,
+                                 int target, cv::Mat &frame);
+
+} // namespace btw
@@ -6,10 +6,22 @@
 // there is no standard header to access modern OpenGL functions easily.
 // Alternatives are GLEW, Glad, etc.)
 
+#include "detection.h"
+#include "detection_index.h"
+#include "detection_worker.h"
+#include "detectors.h"
+#include "face_view.h"
+#include "frame_cache.h"
+#include "frame_decoder.h"
+#include "gl_texture.h"
 #include "imgui_opengl.h"
+#include "playback.h"
+#include "profiler.h"
+#include "scrub_script.h"
+#include "tiled_detection.h"
+#include "trace.h"
 
 #include "opencv2/core/core.hpp"
-#include "opencv2/dnn/dnn.hpp"
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/videoio.hpp"
@@ -17,182 +29,654 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <stdio.h>
+#include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
-struct GLTexture {
-  GLuint id = 0;
-  int width;
-  int height;
+void frame_cache_window(btw::FrameCache &cache) {
+  ImGui::Begin("Frame cache");
 
-  explicit GLTexture(const cv::Mat &image)
-      : width(image.cols), height(image.rows) {
+  static int budget_mb = cache.budget() >> 20;
+  if (ImGui::SliderInt("Budget MB", &budget_mb, 64, 8192)) {
+    cache.set_budget(static_cast<std::size_t>(budget_mb) << 20);
+  }
+
+  const auto &[hits, misses, evictions] = cache.stats();
+  ImGui::Text("frames %ld, %ld MB", cache.frame_count(), cache.bytes() >> 20);
+  ImGui::Text("hits %ld misses %ld evictions %ld", hits, misses, evictions);
+
+  ImGui::End();
+}
+
+void texture_upload_window(btw::GLTexture &texture) {
+  ImGui::Begin("Texture upload");
+
+  constexpr std::array mode_names{"direct", "pbo", "persistent"};
+  int mode = static_cast<int>(texture.upload_mode);
+  if (ImGui::Combo("Mode", &mode, mode_names.data(), size(mode_names))) {
+    texture.upload_mode = static_cast<btw::GLTexture::UploadMode>(mode);
+  }
 
-    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+  ImGui::Text("last upload %s %.3f ms",
+              mode_names[static_cast<int>(texture.last_upload_mode)],
+              texture.last_upload_ms);
 
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, image.step / image.elemSize());
+  ImGui::End();
+}
 
-    constexpr std::array params{std::tuple{GL_TEXTURE_MIN_FILTER, GL_NEAREST},
-                                std::tuple{GL_TEXTURE_MAG_FILTER, GL_LINEAR},
-                                std::tuple{GL_TEXTURE_WRAP_S, GL_CLAMP},
-                                std::tuple{GL_TEXTURE_WRAP_T, GL_CLAMP}};
+void renderer_window(btw::ImguiContext_glfw_opengl &context) {
+  ImGui::Begin("Renderer");
 
-    for (const auto &[p_name, p_value] : params) {
-      glTexParameteri(GL_TEXTURE_2D, p_name, p_value);
+  bool owned = context.is_owned_context();
+  if (ImGui::Checkbox("Owned context (no state backup)", &owned)) {
+    context.set_owned_context(owned);
+    ImGui_ImplOpenGL3_ResetStreamStats();
+  }
+
+  bool persistent = ImGui_ImplOpenGL3_GetPersistentStreaming();
+  if (ImGui::Checkbox("Persistent-mapped streaming", &persistent)) {
+    ImGui_ImplOpenGL3_SetPersistentStreaming(persistent);
+    ImGui_ImplOpenGL3_ResetStreamStats();
+  }
+  ImGui::Text("active: %s", ImGui_ImplOpenGL3_IsPersistentStreaming()
+                                ? "persistent ring"
+                                : "orphaned buffers");
+
+  ImGui_ImplOpenGL3_StreamStats stats;
+  ImGui_ImplOpenGL3_GetStreamStats(&stats);
+  const auto frames = std::max(stats.Frames, 1u);
+  ImGui::Text("%u frames, %llu KB streamed, %u fence waits", stats.Frames,
+              stats.BytesStreamed >> 10, stats.FenceWaits);
+  ImGui::Text("%.1f KB/frame, %.3f ms/frame",
+              static_cast<double>(stats.BytesStreamed) / 1024 / frames,
+              stats.RenderMs / frames);
+  if (ImGui::Button("Reset")) {
+    ImGui_ImplOpenGL3_ResetStreamStats();
+  }
+
+  ImGui::End();
+}
+
+void profiler_window(const btw::Profiler &profiler) {
+  ImGui::Begin("Profiler");
+
+  const auto plot = [](const char *label, const std::vector<float> &samples) {
+    const auto [p50, p95, p99] = btw::percentiles(samples);
+    ImGui::PlotHistogram(label, samples.data(), static_cast<int>(size(samples)),
+                         0, nullptr, 0, std::max(p99 * 1.2f, 1.0f),
+                         {0, 40});
+    ImGui::Text("p50 %.3f  p95 %.3f  p99 %.3f ms", p50, p95, p99);
+  };
+
+  for (std::size_t s = 0; s < btw::stage_count; ++s) {
+    const auto stage = static_cast<btw::Stage>(s);
+    if (!ImGui::CollapsingHeader(btw::stage_name(stage),
+                                 ImGuiTreeNodeFlags_DefaultOpen)) {
+      continue;
     }
+    ImGui::PushID(static_cast<int>(s));
+    plot("cpu", profiler.cpu_samples(stage));
+    if (const auto gpu = profiler.gpu_samples(stage); !gpu.empty()) {
+      plot("gpu", gpu);
+    }
+    ImGui::PopID();
+  }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.cols, image.rows, 0, GL_BGR,
-                 GL_UNSIGNED_BYTE, image.ptr());
+  ImGui::End();
+}
+
+void trace_window(const std::string &trace_path) {
+  ImGui::Begin("Trace");
+
+  bool tracing = btw::trace::enabled();
+  if (ImGui::Checkbox("Record", &tracing)) {
+    btw::trace::set_enabled(tracing);
   }
+  static bool written = true;
+  if (ImGui::Button("Write")) {
+    written = btw::trace::write_json(trace_path);
+  }
+  ImGui::SameLine();
+  if (written) {
+    ImGui::Text("%s", trace_path.c_str());
+  } else {
+    ImGui::Text("failed to write %s", trace_path.c_str());
+  }
+  ImGui::Text("dropped events %zu", btw::trace::dropped_events());
 
-  GLTexture(const GLTexture &) = delete;
-  GLTexture(GLTexture &&) = delete;
-  GLTexture &operator=(const GLTexture &) = delete;
-  GLTexture &operator=(GLTexture &&) = delete;
+  ImGui::End();
+}
 
-  ~GLTexture() {
-    if (id) {
-      glDeleteTextures(1, &id);
+// Play/pause, single-frame steps and speed; space and the arrow keys do the
+// same. Returns the frame to show when a step moved it.
+[[nodiscard]] auto playback_controls(btw::Playback &playback, int frame_i,
+                                     int detection_drops) -> int {
+  const bool keys = !ImGui::GetIO().WantTextInput;
+  if (ImGui::Button(playback.playing() ? "Pause" : "Play") ||
+      (keys && ImGui::IsKeyPressed(GLFW_KEY_SPACE))) {
+    if (playback.playing()) {
+      playback.pause();
+    } else {
+      playback.play(frame_i);
     }
   }
-};
+  ImGui::SameLine();
+  if (ImGui::Button("<") || (keys && ImGui::IsKeyPressed(GLFW_KEY_LEFT))) {
+    frame_i = playback.step(frame_i, -1);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button(">") || (keys && ImGui::IsKeyPressed(GLFW_KEY_RIGHT))) {
+    frame_i = playback.step(frame_i, 1);
+  }
+
+  constexpr std::array speeds{0.25, 0.5, 1.0, 2.0, 4.0, 8.0};
+  constexpr std::array speed_names{"0.25x", "0.5x", "1x", "2x", "4x", "8x"};
+  int speed_i = static_cast<int>(
+      std::find(begin(speeds), end(speeds), playback.speed()) - begin(speeds));
+  ImGui::SameLine();
+  ImGui::PushItemWidth(80);
+  if (ImGui::Combo("Speed", &speed_i, speed_names.data(), size(speed_names))) {
+    playback.set_speed(speeds[speed_i]);
+  }
+  ImGui::PopItemWidth();
+
+  const auto &[shown, dropped] = playback.stats();
+  ImGui::SameLine();
+  ImGui::Text("shown %d dropped %d, detections dropped %d", shown, dropped,
+              detection_drops);
+  ImGui::SameLine();
+  if (ImGui::Button("Reset stats")) {
+    playback.reset_stats();
+  }
+  return frame_i;
+}
+
+// Backend and target combos offering only the pairs this OpenCV build runs;
+// picking a backend picks its first target unless the current one fits.
+void dnn_controls(btw::DnnOptions &dnn) {
+  static const auto available = btw::available_dnn_options();
+
+  const auto combo = [](const char *label, const std::vector<int> &values,
+                        const auto &options, int &value) {
+    std::vector<std::string> names;
+    std::vector<const char *> items;
+    for (const int option : values) {
+      names.push_back(btw::dnn_option_name(options, option));
+    }
+    for (const auto &name : names) {
+      items.push_back(name.c_str());
+    }
+    int selected = static_cast<int>(
+        std::ranges::find(values, value) - begin(values));
+    if (selected == static_cast<int>(size(values))) {
+      selected = 0;
+      value = values.front();
+    }
+    if (ImGui::Combo(label, &selected, items.data(),
+                     static_cast<int>(size(items)))) {
+      value = values[selected];
+    }
+  };
 
-namespace ImGui {
-void Image(const GLTexture &texture) {
+  std::vector<int> backends;
+  for (const auto &[backend, target] : available) {
+    if (std::ranges::find(backends, backend) == end(backends)) {
+      backends.push_back(backend);
+    }
+  }
+  combo("Backend", backends, btw::dnn_backends, dnn.backend);
 
-  ImGui::Image((void *)(intptr_t)texture.id,
-               ImVec2(texture.width, texture.height));
+  std::vector<int> targets;
+  for (const auto &[backend, target] : available) {
+    if (backend == dnn.backend) {
+      targets.push_back(target);
+    }
+  }
+  combo("Target", targets, btw::dnn_targets, dnn.target);
 }
-} // namespace ImGui
-
-[[nodiscard]] auto face_detect(const cv::Mat &frame,
-                               const GLTexture &frame_texture, cv::dnn::Net &n)
-    -> std::vector<std::unique_ptr<GLTexture>> {
-
-  const auto detections = [&n, &frame] {
-    cv::Size s(300, 300);
-
-    cv::Mat resized;
-    cv::resize(frame, resized, s);
-    const auto blob =
-        cv::dnn::blobFromImage(resized, 1.0, s, cv::Scalar(104, 177, 123));
-
-    n.setInput(blob);
-    const cv::Mat detected = n.forward();
-    return detected(std::vector{cv::Range(0, 1), cv::Range(0, 1),
-                                cv::Range::all(), cv::Range::all()})
-        .reshape(0, std::vector{detected.size[2], detected.size[3]});
-  }();
-
-  static float conf_thresh = 0.5;
-  ImGui::SliderFloat("Conf Thresh", &conf_thresh, 0, 1);
-
-  const auto dt = [&detections, conf_thresh] {
-    std::vector<std::array<float, 4>> dt;
-
-    for (int r = 0; r < detections.rows; ++r) {
-      const auto row = detections.row(r);
-      const auto conf = row.at<float>(2);
-      if (conf > conf_thresh) {
-        std::array<float, 4> rect;
-        std::copy_n(row.ptr<float>(0, 3), 4, begin(rect));
-        dt.push_back(rect);
+
+// Picks the detector, its DNN backend and target and OpenCV's thread count.
+// spec is the applied detector, also used by analysis. True when a new
+// detector was applied.
+bool detector_controls(btw::DetectionWorker &worker, btw::DetectorSpec &spec) {
+  ImGui::Text("detector: %s", worker.detector_name().c_str());
+
+  static std::array<char, 1024> spec_text{};
+  static btw::DnnOptions dnn = spec.dnn;
+  static std::string error;
+  if (!spec_text.front()) {
+    spec.to_string().copy(spec_text.data(), size(spec_text) - 1);
+  }
+  ImGui::InputText("Spec", spec_text.data(), size(spec_text));
+  dnn_controls(dnn);
+  bool applied = false;
+  if (ImGui::Button("Apply")) {
+    auto next_spec = btw::DetectorSpec::parse(spec_text.data());
+    if (!next_spec) {
+      error = "bad spec";
+    } else {
+      next_spec->dnn = dnn;
+      auto next = btw::make_detector(*next_spec);
+      if (next->is_open()) {
+        spec = *next_spec;
+        worker.set_detector(std::move(next));
+        error.clear();
+        applied = true;
+      } else {
+        error = next->error();
       }
     }
-    return dt;
-  }();
+  }
+  if (!error.empty()) {
+    ImGui::TextWrapped("%s", error.c_str());
+  }
+  if (const auto failure = worker.error(); !failure.empty()) {
+    ImGui::TextWrapped("detection stopped: %s", failure.c_str());
+  }
 
-  ImGui::Text("toal dec %ld", size(dt));
+  int threads = cv::getNumThreads();
+  const int max_threads =
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  if (ImGui::SliderInt("OpenCV threads", &threads, 1, max_threads)) {
+    cv::setNumThreads(threads);
+  }
+  return applied;
+}
 
-  auto *const draw_list = ImGui::GetWindowDrawList();
+// True when the detection settings changed, so earlier results are stale.
+bool detection_window(btw::DetectionWorker &worker, btw::DetectorSpec &spec) {
+  ImGui::Begin("Detection");
 
-  ImGui::Image(frame_texture);
-  const auto [a0, b0] = ImGui::GetItemRectMin();
+  const bool detector_changed = detector_controls(worker, spec);
 
-  for (const auto [a, b, c, d] : dt) {
-    draw_list->AddRectFilled({a0 + frame.cols * a, b0 + frame.rows * b},
-                             {a0 + frame.cols * c, b0 + frame.rows * d},
-                             ImGui::GetColorU32({0, 0, 1, 0.2}));
+  bool tracking = worker.tracking();
+  if (ImGui::Checkbox("Track between keyframes", &tracking)) {
+    worker.set_tracking(tracking);
+  }
+  static bool tiled = false;
+  static btw::TilingConfig tiling;
+  bool tiling_changed = ImGui::Checkbox("Tiled", &tiled);
+  if (tiled) {
+    tiling_changed |= ImGui::Checkbox("Whole frame too", &tiling.whole_frame);
+    tiling_changed |=
+        ImGui::SliderInt("Tile size", &tiling.tile_sizes.front(), 300, 1920);
+    tiling_changed |= ImGui::SliderFloat("Overlap", &tiling.overlap, 0, 0.5f);
+    tiling_changed |=
+        ImGui::SliderInt("Tiles/batch", &tiling.batch_size, 1, 32);
+  }
+  if (tiling_changed) {
+    worker.set_tiling(tiled ? std::optional(tiling) : std::nullopt);
   }
 
-  ImGui::Begin("Faces");
+  const auto [dropped, forwards, tracked, interval, tiling_stats] =
+      worker.stats();
+  ImGui::Text("Net::forward %d, tracked %d (%.1fx fewer)", forwards, tracked,
+              static_cast<double>(forwards + tracked) / std::max(forwards, 1));
+  if (tracking) {
+    ImGui::Text("keyframe interval %d", interval);
+  }
+  if (tiled) {
+    ImGui::Text("%d tiles, %.2f ms/tile", tiling_stats.tile_count,
+                tiling_stats.tile_ms);
+  }
+  ImGui::Text("dropped %d", dropped);
 
-  std::vector<std::unique_ptr<GLTexture>> res;
+  ImGui::End();
+  return detector_changed || tiling_changed;
+}
 
-  for (const auto [a, b, c, d] : dt) {
-    const cv::Rect roi(cv::Point(frame.cols * a, frame.rows * b),
-                       cv::Point(frame.cols * c, frame.rows * d));
+void analysis_window(const std::string &video_path,
+                     const btw::DetectorSpec &spec, std::jthread &analysis,
+                     btw::AnalysisProgress &progress,
+                     std::optional<btw::DetectionIndex> &index) {
+  ImGui::Begin("Analysis");
+
+  static int stride = 5;
+  static int worker_count = 2;
+  static int batch_size = 4;
+
+  if (progress.running) {
+    const int total = std::max(progress.total.load(), 1);
+    ImGui::ProgressBar(static_cast<float>(progress.done) / total);
+    if (ImGui::Button("Cancel")) {
+      analysis.request_stop();
+    }
+  } else {
+    if (analysis.joinable()) {
+      analysis.join();
+      // Rejected if the detector changed while analyzing.
+      if (progress.succeeded) {
+        index.emplace(video_path, spec.to_string());
+      }
+    }
 
-    if ((roi & cv::Rect(0, 0, frame.cols, frame.rows)) == roi) {
-      const cv::Mat face = frame(roi);
-      res.emplace_back(std::make_unique<GLTexture>(face));
-      ImGui::Image(*res.back());
+    ImGui::SliderInt("Stride", &stride, 1, 60);
+    ImGui::SliderInt("Workers", &worker_count, 1, 16);
+    ImGui::SliderInt("Batch", &batch_size, 1, 32);
+    if (ImGui::Button("Pre-analyze")) {
+      progress.running = true;
+      analysis = std::jthread([&video_path, &progress, spec, stride = stride,
+                               worker_count = worker_count,
+                               batch_size = batch_size](
+                                  std::stop_token stop) {
+        btw::analyze_video(
+            video_path, spec.to_string(),
+            [&spec] { return btw::make_detector(spec); }, stride,
+            worker_count, batch_size, progress, stop);
+      });
     }
   }
 
+  if (index && index->is_open()) {
+    ImGui::Text("index: every %d frames", index->stride());
+  } else {
+    ImGui::Text("no index");
+  }
+
   ImGui::End();
+}
 
-  return res;
+struct Options {
+  // A video file, an image directory or "synthetic:<width>x<height>", see
+  // btw::open_frame_source.
+  std::string source = "synthetic:1280x720";
+  std::string trace_path = "better_window.json";
+  // Render offscreen, replay script_path (or random seeks) and report.
+  bool headless = false;
+  std::string script_path;
+  // Without --detector, the res10 SSD's files in the working directory.
+  btw::DetectorSpec detector{btw::DetectorSpec::Kind::caffe,
+                             "res10_300x300_ssd_iter_140000.caffemodel",
+                             "deploy.prototxt.txt",
+                             {}};
+};
+
+[[nodiscard]] auto parse_options(int argc, char **argv)
+    -> std::optional<Options> {
+  Options options;
+  bool detector_given = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--source" && i + 1 < argc) {
+      options.source = argv[++i];
+    } else if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--script" && i + 1 < argc) {
+      options.script_path = argv[++i];
+    } else if (arg == "--detector" && i + 1 < argc) {
+      auto spec = btw::DetectorSpec::parse(argv[++i]);
+      if (!spec) {
+        return std::nullopt;
+      }
+      spec->dnn = options.detector.dnn;
+      options.detector = *spec;
+      detector_given = true;
+    } else if (arg == "--backend" && i + 1 < argc) {
+      const auto backend = btw::find_dnn_option(btw::dnn_backends, argv[++i]);
+      if (!backend) {
+        return std::nullopt;
+      }
+      options.detector.dnn.backend = *backend;
+    } else if (arg == "--target" && i + 1 < argc) {
+      const auto target = btw::find_dnn_option(btw::dnn_targets, argv[++i]);
+      if (!target) {
+        return std::nullopt;
+      }
+      options.detector.dnn.target = *target;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (!detector_given &&
+      (!std::filesystem::exists(options.detector.config_path) ||
+       !std::filesystem::exists(options.detector.model_path))) {
+    std::cerr << options.detector.to_string()
+              << ": default model files not in the working directory; pass "
+                 "--detector\n";
+    return std::nullopt;
+  }
+  return options;
 }
-void main_loop(btw::ImguiContext_glfw_opengl &context, cv::dnn::Net &n) {
 
-  cv::VideoCapture cap;
-  cap.open(
-      R"(/media/peleg/AAC8C7F7C8C7BFB5/downloads/Better.Call.Saul.S05E06.WEBRip.x264-ION10.mp4)");
-  const auto frame_count = cap.get(cv::CAP_PROP_FRAME_COUNT);
+void main_loop(btw::ImguiContext_glfw_opengl &context,
+               std::unique_ptr<btw::Detector> detector,
+               const Options &options) {
+
+  const std::string &video_path = options.source;
+
+  const auto wake = [&context] { context.wake(); };
+
+  btw::Profiler profiler;
 
-  cv::Mat frame;
-  if (!cap.read(frame)) {
+  btw::FrameDecoder decoder(video_path, wake);
+  const auto frame_count = decoder.frame_count();
+
+  cv::Mat frame = decoder.wait(0);
+  if (frame.empty()) {
+    std::cerr << "can't read " << video_path << '\n';
     return;
   }
 
+  btw::FrameCache cache(std::size_t{1} << 30);
+  cache.put(0, frame);
+
   ImGui::GetIO().ConfigWindowsMoveFromTitleBarOnly = true;
 
-  std::vector<
-      std::vector<std::tuple<cv::Rect, cv::Mat, std::unique_ptr<GLTexture>>>>
-      im_rects_s(frame_count);
+  // Raw detector output per frame index, filtered by threshold when drawn.
+  std::vector<std::optional<btw::Detections>> detections_s(frame_count);
+  // The tracker's boxes for one frame: shown while tracking is on, never
+  // kept in detections_s, so the detector still runs there when tracking is
+  // off or the frame is revisited out of sequence.
+  std::optional<btw::DetectionWorker::Result> tracked_detections;
+  btw::DetectorSpec detector_spec = options.detector;
+  btw::DetectionWorker detection_worker(std::move(detector), wake, &profiler);
+  const btw::Detections pending_detections;
+
+  std::optional<btw::DetectionIndex> detection_index;
+  detection_index.emplace(video_path, detector_spec.to_string());
+  btw::AnalysisProgress analysis_progress;
+  std::jthread analysis;
+
+  btw::GLTexture frame_texture;
+
+  btw::Playback playback(frame_count, decoder.fps());
+  // While playing, the last detections drawn stand in for frames the
+  // detector skipped.
+  btw::Detections last_detections;
+
+  std::optional<btw::ScrubReplay> replay;
+  if (options.headless) {
+    auto script =
+        options.script_path.empty()
+            ? btw::ScrubScript::random(frame_count, 200, 2, 1)
+            : btw::ScrubScript::load(options.script_path);
+    if (!script) {
+      std::cerr << "bad scrub script " << options.script_path << '\n';
+      return;
+    }
+    for (auto &step : script->steps) {
+      step.frame_i = std::min(step.frame_i, frame_count - 1);
+    }
+    replay.emplace(std::move(*script));
+  }
 
-  int frame_old = 0;
+  // Slider position last handled, and the index of the pixels in frame; they
+  // differ when decoding frame_shown failed.
+  int frame_shown = 0;
+  int frame_index = 0;
   int frame_i = 0;
+
+  // Frames still rendered after the last activity so ImGui can settle hover
+  // and animation state. Past that the loop sleeps until input, a worker
+  // result or a running analysis needs a redraw.
+  constexpr int settle_frames = 3;
+  int quiet_frames = 0;
+
   while (context.is_window_open()) {
-    context.start_frame();
+    if (replay || context.take_activity() || analysis_progress.running ||
+        playback.playing()) {
+      quiet_frames = 0;
+    } else if (quiet_frames >= settle_frames) {
+      context.wait_events(1.0);
+      continue;
+    }
+    ++quiet_frames;
+    BTW_TRACE_SCOPE("frame");
+
+    {
+      BTW_TRACE_SCOPE("events");
+      const btw::CpuScope scope(profiler, btw::Stage::events);
+      context.start_frame();
+    }
     ImGui::ShowMetricsWindow();
+    profiler_window(profiler);
 
     ImGui::Begin("image", nullptr, ImGuiWindowFlags_NoSavedSettings);
-    ImGui::SliderInt("slider", &frame_i, 0, frame_count - 1);
-    auto &im_rects = im_rects_s[frame_i];
+    if (replay) {
+      const auto next = replay->next(frame_shown);
+      if (!next) {
+        ImGui::End();
+        ImGui::EndFrame();
+        break;
+      }
+      frame_i = *next;
+    }
+    frame_i = playback_controls(playback, frame_i,
+                                detection_worker.stats().dropped);
+    if (playback.playing()) {
+      frame_i = playback.tick(frame_shown);
+    }
+    if (ImGui::SliderInt("slider", &frame_i, 0, frame_count - 1)) {
+      playback.pause();
+    }
 
-    if (frame_i != frame_old) {
-      cap.set(cv::CAP_PROP_POS_FRAMES, frame_i);
-      cap.read(frame);
-      frame_old = frame_i;
+    if (frame_i != frame_shown) {
+      BTW_TRACE_SCOPE("seek/decode");
+      const btw::CpuScope scope(profiler, btw::Stage::decode);
+      if (const auto cached = cache.get(frame_i)) {
+        frame = *cached;
+        frame_shown = frame_index = frame_i;
+      } else {
+        decoder.request(frame_i);
+        if (const auto decoded = decoder.try_get(frame_i)) {
+          if (!decoded->empty()) {
+            frame = *decoded;
+            frame_index = frame_i;
+            cache.put(frame_i, frame);
+          }
+          frame_shown = frame_i;
+        }
+      }
+    }
+    {
+      BTW_TRACE_SCOPE("upload");
+      const btw::GpuScope scope(profiler, btw::Stage::upload);
+      frame_texture.update(frame, frame_index);
     }
-    auto m = frame;
-    const GLTexture gl_m(frame);
 
-    const auto face_textures = face_detect(frame, gl_m, n);
+    for (auto &result : detection_worker.take_results()) {
+      if (result.tracked) {
+        tracked_detections = std::move(result);
+      } else {
+        detections_s[result.frame_i] = std::move(result.detections);
+      }
+    }
+    auto &detections = detections_s[frame_index];
+    if (!detections && detection_index) {
+      if (const auto stored = detection_index->find(frame_index)) {
+        detections.emplace(begin(*stored), end(*stored));
+      }
+    }
+    const btw::Detections *shown = detections ? &*detections : nullptr;
+    if (!shown && tracked_detections && detection_worker.tracking() &&
+        tracked_detections->frame_i == frame_index) {
+      shown = &tracked_detections->detections;
+    }
+    if (!shown) {
+      detection_worker.submit(frame_index, frame);
+      ImGui::Text("detecting...");
+    } else {
+      last_detections = *shown;
+    }
+    btw::face_detect(frame, frame_texture,
+                     shown                ? *shown
+                     : playback.playing() ? last_detections
+                                          : pending_detections);
 
     ImGui::End();
 
-    context.render({0, 0, 0, 0});
+    frame_cache_window(cache);
+    texture_upload_window(frame_texture);
+    renderer_window(context);
+    if (detection_window(detection_worker, detector_spec)) {
+      // Redetect with the new settings, the visited frames too. The index
+      // was built with the old ones; Pre-analyze reloads it.
+      std::ranges::fill(detections_s, std::nullopt);
+      detection_index.reset();
+      tracked_detections.reset();
+      last_detections.clear();
+    }
+    analysis_window(video_path, detector_spec, analysis, analysis_progress,
+                    detection_index);
+    trace_window(options.trace_path);
+
+    {
+      BTW_TRACE_SCOPE("render");
+      context.render({0, 0, 0, 0}, &profiler);
+    }
+  }
+
+  if (replay) {
+    replay->report(std::cout);
   }
 }
 
-int main(int, char **) {
-  cv::dnn::Net n = cv::dnn::readNetFromCaffe(
-      R"(/media/peleg/AAC8C7F7C8C7BFB5/deep_learning_tut/deep-learning-face-detection/deploy.prototxt.txt)",
-      R"(/media/peleg/AAC8C7F7C8C7BFB5/deep_learning_tut/deep-learning-face-detection/res10_300x300_ssd_iter_140000.caffemodel)");
+int main(int argc, char **argv) {
+  auto options = parse_options(argc, argv);
+  if (!options) {
+    std::cerr << "usage: " << argv[0]
+              << " [--source <video|directory|synthetic:WxH>]"
+                 " (default synthetic:1280x720)"
+                 " [--headless [--script <path>]]\n"
+                 "  [--detector <caffe:<prototxt>,<model>|onnx:<model>|"
+                 "cascade:<xml>>]\n"
+                 "  [--backend <default|opencv|openvino|cuda>]"
+                 " [--target <cpu|opencl|opencl_fp16|cuda|cuda_fp16>]\n";
+    return 2;
+  }
+
+  // BTW_TRACE=<path> records from startup and writes the trace there on exit.
+  const char *const trace_env = std::getenv("BTW_TRACE");
+  if (trace_env) {
+    options->trace_path = trace_env;
+  }
+  btw::trace::set_enabled(trace_env != nullptr);
+  btw::trace::set_thread_name("main");
+
+  auto detector = btw::make_detector(options->detector);
+  if (!detector->is_open()) {
+    std::cerr << "can't open detector " << options->detector.to_string()
+              << ": " << detector->error() << '\n';
+    return 1;
+  }
 
-  btw::ImguiContext_glfw_opengl context(1280, 720, "Better window");
+  btw::ImguiContext_glfw_opengl context(1280, 720, "Better window",
+                                        options->headless);
 
-  main_loop(context, n);
+  main_loop(context, std::move(detector), *options);
 
+  if (trace_env && !btw::trace::write_json(options->trace_path)) {
+    std::cerr << "failed to write trace " << options->trace_path << '\n';
+  }
   return 0;
 }
@@ -0,0 +1,61 @@
+#include "playback.h"
+
+#include <algorithm>
+
+btw::Playback::Playback(int frame_count, double fps)
+    : frame_count(std::max(frame_count, 1)), fps(fps > 0 ? fps : 30) {}
+
+bool btw::Playback::playing() const { return is_playing; }
+
+double btw::Playback::speed() const { return rate; }
+
+auto btw::Playback::stats() const -> const Stats & { return counts; }
+
+void btw::Playback::play(int frame_i) {
+  if (frame_i >= frame_count - 1) {
+    frame_i = 0;
+  }
+  is_playing = true;
+  anchor_time = clock::now();
+  anchor_frame = std::max(frame_i, 0);
+  last_shown = anchor_frame;
+}
+
+void btw::Playback::pause() { is_playing = false; }
+
+void btw::Playback::set_speed(double speed) {
+  const auto now = clock::now();
+  if (is_playing) {
+    anchor_frame = due(now);
+    anchor_time = now;
+  }
+  rate = std::clamp(speed, min_speed, max_speed);
+}
+
+void btw::Playback::reset_stats() { counts = {}; }
+
+auto btw::Playback::due(clock::time_point now) const -> int {
+  const double elapsed = std::chrono::duration<double>(now - anchor_time).count();
+  const auto frames = static_cast<long long>(elapsed * fps * rate);
+  return static_cast<int>(
+      std::min<long long>(anchor_frame + frames, frame_count - 1));
+}
+
+auto btw::Playback::tick(int frame_shown) -> int {
+  if (frame_shown > last_shown) {
+    ++counts.shown;
+    counts.dropped += frame_shown - last_shown - 1;
+  }
+  last_shown = frame_shown;
+
+  const int frame_i = due(clock::now());
+  if (frame_shown >= frame_count - 1) {
+    is_playing = false;
+  }
+  return frame_i;
+}
+
+auto btw::Playback::step(int frame_i, int delta) -> int {
+  pause();
+  return std::clamp(frame_i + delta, 0, frame_count - 1);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+
+namespace btw {
+
+// Paces playback to the source frame rate times a speed factor. The frame due
+// is computed from the wall clock since playback last (re)started, so when
+// decoding or detection can't keep up frames are skipped rather than the
+// video slowing down; skipped frames are counted as dropped.
+struct Playback {
+  static constexpr double min_speed = 0.25;
+  static constexpr double max_speed = 8;
+
+  struct Stats {
+    // Distinct frames shown while playing.
+    int shown = 0;
+    // Frames skipped between two shown ones.
+    int dropped = 0;
+  };
+
+  // fps <= 0, as some containers report, falls back to 30.
+  Playback(int frame_count, double fps);
+
+  [[nodiscard]] bool playing() const;
+  [[nodiscard]] double speed() const;
+  [[nodiscard]] auto stats() const -> const Stats &;
+
+  // Restarts from frame_i, or from the start if it is the last frame.
+  void play(int frame_i);
+  void pause();
+  // Clamped to [min_speed, max_speed]. Keeps the current position.
+  void set_speed(double speed);
+  void reset_stats();
+
+  // Called once per UI frame while playing with the frame currently shown.
+  // Returns the frame due now; pauses once the last frame is shown.
+  [[nodiscard]] auto tick(int frame_shown) -> int;
+
+  // Pauses and returns frame_i moved by delta, clamped to the sequence.
+  [[nodiscard]] auto step(int frame_i, int delta) -> int;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  [[nodiscard]] auto due(clock::time_point now) const -> int;
+
+  int frame_count;
+  double fps;
+  double rate = 1;
+  bool is_playing = false;
+
+  // Playback runs from anchor_frame at anchor_time.
+  clock::time_point anchor_time;
+  int anchor_frame = 0;
+  int last_shown = -1;
+  Stats counts;
+};
+
+} // namespace btw
@@ -0,0 +1,222 @@
+#include "preprocess.h"
+#include "trace.h"
+
+#include "opencv2/core/utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BTW_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Source sample positions of each output column or row, as cv::resize's
+// INTER_LINEAR computes them: pixel centres aligned, clamped at the borders.
+struct Taps {
+  // Byte offsets of the left and right pixels for columns, row indices for
+  // rows.
+  std::vector<std::int32_t> first;
+  std::vector<std::int32_t> second;
+  std::vector<float> weight;
+};
+
+[[nodiscard]] auto make_taps(int out_size, int in_offset, int in_size,
+                             int stride) -> Taps {
+  Taps taps;
+  taps.first.resize(out_size);
+  taps.second.resize(out_size);
+  taps.weight.resize(out_size);
+  const double scale = static_cast<double>(in_size) / out_size;
+  for (int i = 0; i < out_size; ++i) {
+    const double position = (i + 0.5) * scale - 0.5;
+    int low = static_cast<int>(std::floor(position));
+    float weight = static_cast<float>(position - low);
+    if (low < 0) {
+      low = 0;
+      weight = 0;
+    }
+    if (low >= in_size - 1) {
+      low = in_size - 1;
+      weight = 0;
+    }
+    const int high = std::min(low + 1, in_size - 1);
+    taps.first[i] = (in_offset + low) * stride;
+    taps.second[i] = (in_offset + high) * stride;
+    taps.weight[i] = weight;
+  }
+  return taps;
+}
+
+struct Rows {
+  const std::uint8_t *top;
+  const std::uint8_t *bottom;
+  float weight;
+};
+
+// Output columns [begin, end) of one row. mean and planes are indexed by
+// source channel.
+void row_scalar(const Rows &rows, const Taps &columns, int begin, int end,
+                const std::array<float, 3> &mean, float scale,
+                const std::array<float *, 3> &planes) {
+  for (int x = begin; x < end; ++x) {
+    const int left = columns.first[x];
+    const int right = columns.second[x];
+    const float wx = columns.weight[x];
+    for (int c = 0; c < 3; ++c) {
+      const float top =
+          rows.top[left + c] + (rows.top[right + c] - rows.top[left + c]) * wx;
+      const float bottom =
+          rows.bottom[left + c] +
+          (rows.bottom[right + c] - rows.bottom[left + c]) * wx;
+      planes[c][x] = (top + (bottom - top) * rows.weight - mean[c]) * scale;
+    }
+  }
+}
+
+#ifdef BTW_HAVE_AVX2_KERNEL
+
+// The bytes at row + offsets as floats. Gathers 32-bit words and keeps their
+// low byte, so it reads up to three bytes past each sampled one.
+__attribute__((target("avx2"))) inline __m256
+sample_avx2(const std::uint8_t *row, __m256i offsets) {
+  const __m256i words =
+      _mm256_i32gather_epi32(reinterpret_cast<const int *>(row), offsets, 1);
+  return _mm256_cvtepi32_ps(_mm256_and_si256(words, _mm256_set1_epi32(0xFF)));
+}
+
+// Eight output columns at a time, up to end, which the caller keeps below
+// columns whose samples would read past the row. Returns the first column
+// left for row_scalar.
+__attribute__((target("avx2"))) int
+row_avx2(const Rows &rows, const Taps &columns, int end,
+         const std::array<float, 3> &mean, float scale,
+         const std::array<float *, 3> &planes) {
+  const __m256 wy = _mm256_set1_ps(rows.weight);
+  const __m256 factor = _mm256_set1_ps(scale);
+
+  int x = 0;
+  for (; x + 8 <= end; x += 8) {
+    const __m256i left = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(columns.first.data() + x));
+    const __m256i right = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(columns.second.data() + x));
+    const __m256 wx = _mm256_loadu_ps(columns.weight.data() + x);
+    for (int c = 0; c < 3; ++c) {
+      const __m256 tl = sample_avx2(rows.top + c, left);
+      const __m256 tr = sample_avx2(rows.top + c, right);
+      const __m256 bl = sample_avx2(rows.bottom + c, left);
+      const __m256 br = sample_avx2(rows.bottom + c, right);
+      const __m256 top =
+          _mm256_add_ps(tl, _mm256_mul_ps(_mm256_sub_ps(tr, tl), wx));
+      const __m256 bottom =
+          _mm256_add_ps(bl, _mm256_mul_ps(_mm256_sub_ps(br, bl), wx));
+      const __m256 value = _mm256_add_ps(
+          top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), wy));
+      _mm256_storeu_ps(
+          planes[c] + x,
+          _mm256_mul_ps(_mm256_sub_ps(value, _mm256_set1_ps(mean[c])),
+                        factor));
+    }
+  }
+  return x;
+}
+
+#endif
+
+} // namespace
+
+namespace {
+
+// Writes one frame's three planes at data, in source channel order unless
+// swap_rb; means are in source channel order.
+void fill_planes(const cv::Mat &frame, cv::Size size,
+                 const std::array<float, 3> &means, float scale, bool swap_rb,
+                 btw::BlobFit fit, float *data) {
+  CV_Assert(frame.type() == CV_8UC3 && !frame.empty());
+
+  cv::Rect source(0, 0, frame.cols, frame.rows);
+  if (fit == btw::BlobFit::crop) {
+    // The largest centred rect with the output's aspect ratio.
+    const double aspect = static_cast<double>(size.width) / size.height;
+    if (frame.cols > frame.rows * aspect) {
+      source.width = std::max(cvRound(frame.rows * aspect), 1);
+      source.x = (frame.cols - source.width) / 2;
+    } else {
+      source.height = std::max(cvRound(frame.cols / aspect), 1);
+      source.y = (frame.rows - source.height) / 2;
+    }
+  }
+
+  const auto columns = make_taps(size.width, source.x, source.width, 3);
+  const auto rows = make_taps(size.height, source.y, source.height, 1);
+
+  // Columns whose gathers stay inside the row; right offsets only grow.
+  int vector_end = 0;
+#ifdef BTW_HAVE_AVX2_KERNEL
+  if (cv::checkHardwareSupport(CV_CPU_AVX2)) {
+    const int last_safe = frame.cols * 3 - 6;
+    vector_end = static_cast<int>(
+        std::upper_bound(begin(columns.second), end(columns.second),
+                         last_safe) -
+        begin(columns.second));
+  }
+#endif
+
+  const auto plane_size = static_cast<std::size_t>(size.area());
+  cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range &range) {
+    for (int y = range.start; y < range.end; ++y) {
+      const Rows row{frame.ptr<std::uint8_t>(rows.first[y]),
+                     frame.ptr<std::uint8_t>(rows.second[y]), rows.weight[y]};
+      const std::size_t offset = y * size.width;
+      std::array planes{data + offset, data + plane_size + offset,
+                        data + 2 * plane_size + offset};
+      if (swap_rb) {
+        std::swap(planes[0], planes[2]);
+      }
+      int x = 0;
+#ifdef BTW_HAVE_AVX2_KERNEL
+      if (vector_end > 0) {
+        x = row_avx2(row, columns, vector_end, means, scale, planes);
+      }
+#endif
+      row_scalar(row, columns, x, size.width, means, scale, planes);
+    }
+  });
+}
+
+} // namespace
+
+void btw::blob_from_frame(const cv::Mat &frame, cv::Size size,
+                          const cv::Scalar &mean, BlobFit fit, cv::Mat &blob,
+                          double scale, bool swap_rb) {
+  blob_from_frames({&frame, 1}, size, mean, fit, blob, scale, swap_rb);
+}
+
+void btw::blob_from_frames(std::span<const cv::Mat> frames, cv::Size size,
+                           const cv::Scalar &mean, BlobFit fit, cv::Mat &blob,
+                           double scale, bool swap_rb) {
+  BTW_TRACE_FUNCTION();
+  CV_Assert(!frames.empty() && !size.empty());
+
+  const int dims[] = {static_cast<int>(frames.size()), 3, size.height,
+                      size.width};
+  blob.create(4, dims, CV_32F);
+
+  // mean is in output order; the kernels index it by source channel.
+  const int first = swap_rb ? 2 : 0;
+  const std::array<float, 3> means{static_cast<float>(mean[first]),
+                                   static_cast<float>(mean[1]),
+                                   static_cast<float>(mean[2 - first])};
+  const auto image_size = 3 * static_cast<std::size_t>(size.area());
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    fill_planes(frames[i], size, means, static_cast<float>(scale), swap_rb,
+                fit, blob.ptr<float>() + i * image_size);
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+#include <span>
+
+namespace btw {
+
+// How a frame is fitted to the network input.
+enum class BlobFit {
+  // Resized to the input size, ignoring the aspect ratio.
+  stretch,
+  // The centre of the frame with the input's aspect ratio, resized.
+  crop,
+};
+
+// Fills blob, a 1x3xHxW CV_32F tensor reallocated only when its shape
+// changes, with the 8-bit BGR frame bilinearly resized to size, minus mean per
+// channel, times scale, channel planes in BGR order or RGB with swap_rb. The
+// same as cv::resize followed by cv::dnn::blobFromImage(resized, scale, size,
+// mean, swap_rb) (or blobFromImage with crop), but in one pass: each output
+// pixel is interpolated from the source, normalized and stored straight into
+// its plane, with no intermediate image. As with blobFromImage, mean is in
+// the output's channel order. Uses AVX2 when the CPU has it.
+void blob_from_frame(const cv::Mat &frame, cv::Size size,
+                     const cv::Scalar &mean, BlobFit fit, cv::Mat &blob,
+                     double scale = 1, bool swap_rb = false);
+
+// The same for a batch: blob is Nx3xHxW with frames in order, like
+// cv::dnn::blobFromImages. Frames may differ in size.
+void blob_from_frames(std::span<const cv::Mat> frames, cv::Size size,
+                      const cv::Scalar &mean, BlobFit fit, cv::Mat &blob,
+                      double scale = 1, bool swap_rb = false);
+
+} // namespace btw
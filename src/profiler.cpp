@@ -0,0 +1,132 @@
+#include "profiler.h"
+#include "gl_ext.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+[[nodiscard]] auto stage_index(btw::Stage stage) -> std::size_t {
+  return static_cast<std::size_t>(stage);
+}
+
+} // namespace
+
+auto btw::stage_name(Stage stage) -> const char * {
+  constexpr std::array<const char *, stage_count> names{
+      "events",        "seek/decode", "preprocess", "forward",
+      "postprocess",   "tile",        "tracking",   "upload",
+      "ImGui::Render", "RenderDrawData"};
+  return names[stage_index(stage)];
+}
+
+auto btw::percentiles(std::vector<float> samples) -> Percentiles {
+  if (samples.empty()) {
+    return {};
+  }
+  const auto at = [&samples](double p) {
+    const auto nth = begin(samples) + static_cast<std::ptrdiff_t>(
+                                          p * (size(samples) - 1) + 0.5);
+    std::nth_element(begin(samples), nth, end(samples));
+    return *nth;
+  };
+  return {at(0.50), at(0.95), at(0.99)};
+}
+
+void btw::Profiler::History::push(float ms) {
+  samples[count % history] = ms;
+  ++count;
+}
+
+auto btw::Profiler::History::ordered() const -> std::vector<float> {
+  const auto n = std::min<std::size_t>(count, history);
+  std::vector<float> out;
+  out.reserve(n);
+  for (auto i = count - n; i < count; ++i) {
+    out.push_back(samples[i % history]);
+  }
+  return out;
+}
+
+void btw::Profiler::record_cpu(Stage stage, double ms) {
+  const std::lock_guard lock(mutex);
+  cpu[stage_index(stage)].push(static_cast<float>(ms));
+}
+
+void btw::Profiler::begin_gpu(Stage stage) {
+  if (!gl_ext::has_timer_query()) {
+    return;
+  }
+  auto &query = queries[slot][stage_index(stage)];
+  if (!query) {
+    glGenQueries(1, &query);
+  }
+  glBeginQuery(GL_TIME_ELAPSED, query);
+  issued[slot][stage_index(stage)] = true;
+}
+
+void btw::Profiler::end_gpu() {
+  if (gl_ext::has_timer_query()) {
+    glEndQuery(GL_TIME_ELAPSED);
+  }
+}
+
+void btw::Profiler::end_frame() {
+  slot = (slot + 1) % gpu_latency;
+
+  // The slot about to be reused was issued gpu_latency - 1 frames ago.
+  for (std::size_t s = 0; s < stage_count; ++s) {
+    if (!std::exchange(issued[slot][s], false)) {
+      continue;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(queries[slot][s], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+      continue;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(queries[slot][s], GL_QUERY_RESULT, &ns);
+
+    const std::lock_guard lock(mutex);
+    gpu[s].push(static_cast<float>(ns / 1e6));
+  }
+}
+
+auto btw::Profiler::cpu_samples(Stage stage) const -> std::vector<float> {
+  const std::lock_guard lock(mutex);
+  return cpu[stage_index(stage)].ordered();
+}
+
+auto btw::Profiler::gpu_samples(Stage stage) const -> std::vector<float> {
+  const std::lock_guard lock(mutex);
+  return gpu[stage_index(stage)].ordered();
+}
+
+btw::Profiler::~Profiler() {
+  for (auto &frame_queries : queries) {
+    for (auto &query : frame_queries) {
+      if (query) {
+        glDeleteQueries(1, &query);
+      }
+    }
+  }
+}
+
+btw::CpuScope::CpuScope(Profiler &profiler, Stage stage)
+    : profiler(profiler), stage(stage),
+      start(std::chrono::steady_clock::now()) {}
+
+btw::CpuScope::~CpuScope() {
+  profiler.record_cpu(
+      stage, std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                 .count());
+}
+
+btw::GpuScope::GpuScope(Profiler &profiler, Stage stage)
+    : profiler(profiler), cpu(profiler, stage) {
+  profiler.begin_gpu(stage);
+}
+
+btw::GpuScope::~GpuScope() { profiler.end_gpu(); }
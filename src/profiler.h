@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace btw {
+
+// Stages of a main_loop frame. Detection stages run on the detection worker.
+enum class Stage {
+  events,
+  decode,
+  preprocess,
+  inference,
+  postprocess,
+  // Forward time per tile in tiled detection.
+  tile,
+  tracking,
+  upload,
+  imgui_render,
+  draw_data,
+  count,
+};
+
+inline constexpr auto stage_count = static_cast<std::size_t>(Stage::count);
+
+[[nodiscard]] auto stage_name(Stage stage) -> const char *;
+
+struct Percentiles {
+  float p50 = 0;
+  float p95 = 0;
+  float p99 = 0;
+};
+
+// Samples are in milliseconds, oldest first.
+[[nodiscard]] auto percentiles(std::vector<float> samples) -> Percentiles;
+
+// Keeps the last history CPU and GPU timings of every stage. CPU samples can
+// be recorded from any thread. GPU timings use GL_TIME_ELAPSED queries and
+// are read back gpu_latency frames later, skipping any not yet available, so
+// the render thread never waits on the GPU. GPU scopes must not nest, and
+// record only CPU time without timer queries.
+struct Profiler {
+  static constexpr int history = 240;
+  static constexpr int gpu_latency = 4;
+
+  Profiler() = default;
+
+  Profiler(const Profiler &) = delete;
+  Profiler(Profiler &&) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+  Profiler &operator=(Profiler &&) = delete;
+
+  void record_cpu(Stage stage, double ms);
+
+  // Render thread only, with the GL context current.
+  void begin_gpu(Stage stage);
+  void end_gpu();
+  // Collects finished GPU timings and moves on to the next query slot.
+  void end_frame();
+
+  [[nodiscard]] auto cpu_samples(Stage stage) const -> std::vector<float>;
+  [[nodiscard]] auto gpu_samples(Stage stage) const -> std::vector<float>;
+
+  ~Profiler();
+
+private:
+  struct History {
+    std::array<float, history> samples{};
+    std::size_t count = 0;
+
+    void push(float ms);
+    [[nodiscard]] auto ordered() const -> std::vector<float>;
+  };
+
+  mutable std::mutex mutex;
+  std::array<History, stage_count> cpu;
+  std::array<History, stage_count> gpu;
+
+  // Query objects per frame slot and stage, created on first use.
+  std::array<std::array<GLuint, stage_count>, gpu_latency> queries{};
+  std::array<std::array<bool, stage_count>, gpu_latency> issued{};
+  int slot = 0;
+};
+
+// Records the CPU time from construction to destruction.
+struct CpuScope {
+  CpuScope(Profiler &profiler, Stage stage);
+
+  CpuScope(const CpuScope &) = delete;
+  CpuScope &operator=(const CpuScope &) = delete;
+
+  ~CpuScope();
+
+private:
+  Profiler &profiler;
+  Stage stage;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Records both the CPU and the GPU time of the enclosed GL commands.
+struct GpuScope {
+  GpuScope(Profiler &profiler, Stage stage);
+
+  GpuScope(const GpuScope &) = delete;
+  GpuScope &operator=(const GpuScope &) = delete;
+
+  ~GpuScope();
+
+private:
+  Profiler &profiler;
+  CpuScope cpu;
+};
+
+} // namespace btw
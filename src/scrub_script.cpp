@@ -0,0 +1,117 @@
+#include "scrub_script.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <utility>
+
+auto btw::ScrubScript::load(const std::string &path)
+    -> std::optional<ScrubScript> {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  return parse(in);
+}
+
+auto btw::ScrubScript::parse(std::istream &in) -> std::optional<ScrubScript> {
+  ScrubScript script;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string word;
+    if (!(words >> word)) {
+      continue;
+    }
+
+    Step step;
+    if (word != "seek" || !(words >> step.frame_i) || step.frame_i < 0) {
+      return std::nullopt;
+    }
+    if (words >> word &&
+        (word != "hold" || !(words >> step.hold_frames) ||
+         step.hold_frames < 0)) {
+      return std::nullopt;
+    }
+    script.steps.push_back(step);
+  }
+  return script;
+}
+
+auto btw::ScrubScript::random(int frame_count, int seek_count,
+                              int hold_frames, std::uint32_t seed)
+    -> ScrubScript {
+  std::mt19937 engine(seed);
+  std::uniform_int_distribution<int> frames(0, std::max(frame_count - 1, 0));
+
+  ScrubScript script;
+  script.steps.reserve(seek_count);
+  for (int i = 0; i < seek_count; ++i) {
+    script.steps.push_back({frames(engine), hold_frames});
+  }
+  return script;
+}
+
+btw::ScrubReplay::ScrubReplay(ScrubScript script) : script(std::move(script)) {}
+
+auto btw::ScrubReplay::next(int frame_shown) -> std::optional<int> {
+  const auto now = clock::now();
+  const auto ms = [](clock::duration d) {
+    return std::chrono::duration<float, std::milli>(d).count();
+  };
+  if (last_frame) {
+    frame_ms.push_back(ms(now - *last_frame));
+  } else {
+    start = now;
+  }
+  last_frame = now;
+
+  while (step < size(script.steps)) {
+    const auto [frame_i, hold_frames] = script.steps[step];
+    if (!seek_start) {
+      seek_start = now;
+      return frame_i;
+    }
+    if (hold_left < 0) {
+      if (frame_shown == frame_i) {
+        seek_ms.push_back(ms(now - *seek_start));
+        hold_left = hold_frames;
+      } else if (now - *seek_start > seek_timeout) {
+        ++timeouts;
+        hold_left = 0;
+      } else {
+        return frame_i;
+      }
+    }
+    if (hold_left > 0) {
+      --hold_left;
+      return frame_i;
+    }
+    ++step;
+    seek_start.reset();
+    hold_left = -1;
+  }
+  return std::nullopt;
+}
+
+void btw::ScrubReplay::report(std::ostream &out) const {
+  const auto seconds =
+      last_frame ? std::chrono::duration<double>(*last_frame - start).count()
+                 : 0.0;
+  const auto print = [&out](const char *name, const std::vector<float> &ms) {
+    const auto [p50, p95, p99] = percentiles(ms);
+    out << name << " ms: p50 " << p50 << " p95 " << p95 << " p99 " << p99
+        << " (" << size(ms) << " samples)\n";
+  };
+
+  out << size(frame_ms) << " frames in " << seconds << " s, "
+      << (seconds > 0 ? size(frame_ms) / seconds : 0.0) << " fps\n";
+  print("frame", frame_ms);
+  print("seek", seek_ms);
+  out << timeouts << " seeks timed out\n";
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace btw {
+
+// A replayable sequence of slider seeks, each followed by a hold of some UI
+// frames once the target frame is on screen. The text form has one step per
+// line, "seek <frame> [hold <frames>]"; blank lines and '#' comments are
+// skipped.
+struct ScrubScript {
+  struct Step {
+    int frame_i = 0;
+    int hold_frames = 0;
+  };
+
+  std::vector<Step> steps;
+
+  [[nodiscard]] static auto load(const std::string &path)
+      -> std::optional<ScrubScript>;
+  [[nodiscard]] static auto parse(std::istream &in)
+      -> std::optional<ScrubScript>;
+
+  // seek_count uniformly random seeks, the same for a given seed.
+  [[nodiscard]] static auto random(int frame_count, int seek_count,
+                                   int hold_frames, std::uint32_t seed)
+      -> ScrubScript;
+};
+
+// Plays a ScrubScript against the render loop and measures it: the latency
+// from each seek until its frame is shown, and the time of every UI frame.
+struct ScrubReplay {
+  // Seeks whose frame doesn't arrive in time are counted and skipped.
+  static constexpr std::chrono::seconds seek_timeout{10};
+
+  explicit ScrubReplay(ScrubScript script);
+
+  // Called once per UI frame with the frame currently shown. Returns the
+  // frame to show next, nullopt when the script is done.
+  [[nodiscard]] auto next(int frame_shown) -> std::optional<int>;
+
+  void report(std::ostream &out) const;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  ScrubScript script;
+  std::size_t step = 0;
+  // UI frames left to hold, or -1 while waiting for the step's frame.
+  int hold_left = -1;
+
+  clock::time_point start;
+  // When the current step's seek was issued.
+  std::optional<clock::time_point> seek_start;
+  std::optional<clock::time_point> last_frame;
+  std::vector<float> seek_ms;
+  std::vector<float> frame_ms;
+  int timeouts = 0;
+};
+
+} // namespace btw
@@ -0,0 +1,131 @@
+#include "tiled_detection.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Tile origins along one axis: evenly spread so the first tile starts at 0,
+// the last ends at length and neighbours overlap by at least overlap.
+[[nodiscard]] auto tile_origins(int length, int tile, float overlap)
+    -> std::vector<int> {
+  if (tile >= length) {
+    return {0};
+  }
+  const double stride = tile * (1.0 - overlap);
+  const int count =
+      1 + static_cast<int>(std::ceil((length - tile) / std::max(stride, 1.0)));
+  std::vector<int> origins(count);
+  for (int i = 0; i < count; ++i) {
+    origins[i] = static_cast<int>(
+        std::lround(static_cast<double>(length - tile) * i / (count - 1)));
+  }
+  return origins;
+}
+
+} // namespace
+
+auto btw::tile_rects(cv::Size frame_size, const TilingConfig &config)
+    -> std::vector<cv::Rect> {
+  std::vector<cv::Rect> tiles;
+  if (config.whole_frame) {
+    tiles.emplace_back(cv::Point(), frame_size);
+  }
+  const int shorter = std::min(frame_size.width, frame_size.height);
+  const float overlap = std::clamp(config.overlap, 0.0f, 0.9f);
+  for (const int size : config.tile_sizes) {
+    const int side = std::min(size, shorter);
+    if (side <= 0) {
+      continue;
+    }
+    for (const int y : tile_origins(frame_size.height, side, overlap)) {
+      for (const int x : tile_origins(frame_size.width, side, overlap)) {
+        tiles.emplace_back(x, y, side, side);
+      }
+    }
+  }
+  return tiles;
+}
+
+auto btw::non_max_suppression(Detections detections, float iou_threshold)
+    -> Detections {
+  std::sort(begin(detections), end(detections),
+            [](const Detection &a, const Detection &b) {
+              return a.confidence > b.confidence;
+            });
+  Detections kept;
+  for (const auto &detection : detections) {
+    const bool duplicate =
+        std::any_of(begin(kept), end(kept), [&](const Detection &other) {
+          return iou(detection.rect, other.rect) > iou_threshold;
+        });
+    if (!duplicate) {
+      kept.push_back(detection);
+    }
+  }
+  return kept;
+}
+
+auto btw::detect_faces_tiled(const cv::Mat &frame, Detector &detector,
+                             const TilingConfig &config,
+                             DetectionTimings *timings, TilingStats *stats)
+    -> Detections {
+  BTW_TRACE_FUNCTION();
+  const auto tiles = tile_rects(frame.size(), config);
+  const auto batch_size =
+      static_cast<std::size_t>(std::max(config.batch_size, 1));
+
+  DetectionTimings total;
+  Detections detections;
+  std::vector<std::pair<int, cv::Mat>> batch;
+  batch.reserve(batch_size);
+  for (std::size_t first = 0; first < size(tiles); first += batch_size) {
+    batch.clear();
+    for (std::size_t i = first; i < std::min(first + batch_size, size(tiles));
+         ++i) {
+      batch.emplace_back(static_cast<int>(i), frame(tiles[i]));
+    }
+
+    DetectionTimings t;
+    for (const auto &[tile_i, tile_detections] :
+         detect_faces_batch(batch, detector, &t)) {
+      const auto &tile = tiles[tile_i];
+      const float sx = static_cast<float>(tile.width) / frame.cols;
+      const float sy = static_cast<float>(tile.height) / frame.rows;
+      const float ox = static_cast<float>(tile.x) / frame.cols;
+      const float oy = static_cast<float>(tile.y) / frame.rows;
+      for (const auto &[confidence, rect] : tile_detections) {
+        if (confidence < config.min_confidence) {
+          continue;
+        }
+        detections.push_back({confidence,
+                              {ox + rect[0] * sx, oy + rect[1] * sy,
+                               ox + rect[2] * sx, oy + rect[3] * sy}});
+      }
+    }
+    total.preprocess_ms += t.preprocess_ms;
+    total.forward_ms += t.forward_ms;
+    total.postprocess_ms += t.postprocess_ms;
+  }
+
+  {
+    BTW_TRACE_SCOPE("nms");
+    const auto start = std::chrono::steady_clock::now();
+    detections = non_max_suppression(std::move(detections), config.nms_iou);
+    total.postprocess_ms += std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+  }
+
+  if (timings) {
+    *timings = total;
+  }
+  if (stats) {
+    stats->tile_count = static_cast<int>(size(tiles));
+    stats->tile_ms = tiles.empty() ? 0 : total.forward_ms / size(tiles);
+  }
+  return detections;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "detection.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+namespace btw {
+
+// Detection over overlapping square tiles, so faces too small to survive
+// squashing the whole frame to the 300x300 input are seen at a usable scale.
+struct TilingConfig {
+  // Also detect on the whole frame, which finds faces larger than a tile.
+  bool whole_frame = true;
+  // Tile sides in frame pixels, one grid per size; sides above the frame's
+  // shorter side are clamped to it.
+  std::vector<int> tile_sizes{640};
+  // Fraction of a tile shared with its neighbour.
+  float overlap = 0.25f;
+  // Tiles per forward pass.
+  int batch_size = 8;
+  // Rows below this are dropped before merging.
+  float min_confidence = 0.1f;
+  // Overlapping detections above this IoU are merged into the stronger one.
+  float nms_iou = 0.4f;
+};
+
+struct TilingStats {
+  int tile_count = 0;
+  // Forward time per tile, in milliseconds.
+  double tile_ms = 0;
+};
+
+// The tiles of a frame of frame_size, whole frame first.
+[[nodiscard]] auto tile_rects(cv::Size frame_size, const TilingConfig &config)
+    -> std::vector<cv::Rect>;
+
+// Greedy non-maximum suppression: keeps detections by falling confidence,
+// dropping any that overlaps a kept one by more than iou_threshold.
+[[nodiscard]] auto non_max_suppression(Detections detections,
+                                       float iou_threshold) -> Detections;
+
+// Runs the detector on every tile in batches, maps the detections back to
+// normalized frame coordinates and merges cross-tile duplicates. timings sum
+// over all batches.
+[[nodiscard]] auto detect_faces_tiled(const cv::Mat &frame,
+                                      Detector &detector,
+                                      const TilingConfig &config,
+                                      DetectionTimings *timings = nullptr,
+                                      TilingStats *stats = nullptr)
+    -> Detections;
+
+} // namespace btw
@@ -0,0 +1,192 @@
+#include "trace.h"
+#include "json.h"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct btw::trace::detail::Buffer {
+  static constexpr std::size_t capacity = std::size_t{1} << 16;
+
+  struct Event {
+    const char *name;
+    std::int64_t start_ns;
+    std::int64_t duration_ns;
+  };
+
+  explicit Buffer(int tid) : tid(tid) {}
+
+  // Written only by the owning thread. Readers take count first and only
+  // look at events below it. Allocated on the first event, so threads that
+  // never record cost no event storage.
+  std::unique_ptr<Event[]> events;
+  std::atomic<std::size_t> count = 0;
+  std::atomic<std::size_t> dropped = 0;
+  // The recording count and dropped belong to. The owner resets them on its
+  // first event of a newer one; readers skip buffers of older ones.
+  std::atomic<int> session = 0;
+  const int tid;
+  // Guarded by the registry mutex.
+  std::string name;
+  // Its thread exited; kept only for its events.
+  bool retired = false;
+};
+
+std::atomic<bool> btw::trace::detail::enabled = false;
+
+namespace {
+
+using btw::trace::detail::Buffer;
+
+const auto epoch = std::chrono::steady_clock::now();
+
+// Bumped, under the registry mutex, each time tracing is enabled.
+std::atomic<int> session = 0;
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Buffer>> buffers;
+  int next_tid = 1;
+};
+
+// Never destroyed: threads may still record while static destructors run.
+auto registry() -> Registry & {
+  static auto *const instance = new Registry;
+  return *instance;
+}
+
+auto register_thread() -> Buffer * {
+  auto &r = registry();
+  const std::lock_guard lock(r.mutex);
+  return r.buffers.emplace_back(std::make_unique<Buffer>(r.next_tid++)).get();
+}
+
+// Frees the buffer of an exiting thread unless it holds events to write.
+void retire_thread(Buffer *buffer) {
+  auto &r = registry();
+  const std::lock_guard lock(r.mutex);
+  if (buffer->session.load(std::memory_order_relaxed) == session &&
+      buffer->count.load(std::memory_order_relaxed) > 0) {
+    buffer->retired = true;
+    return;
+  }
+  std::erase_if(r.buffers, [buffer](const std::unique_ptr<Buffer> &b) {
+    return b.get() == buffer;
+  });
+}
+
+// The calling thread's registration, retired when the thread exits.
+struct ThreadBuffer {
+  Buffer *const buffer = register_thread();
+
+  ThreadBuffer() = default;
+  ThreadBuffer(const ThreadBuffer &) = delete;
+  ThreadBuffer &operator=(const ThreadBuffer &) = delete;
+
+  ~ThreadBuffer() { retire_thread(buffer); }
+};
+
+} // namespace
+
+auto btw::trace::detail::now_ns() -> std::int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+auto btw::trace::detail::thread_buffer() -> Buffer & {
+  thread_local const ThreadBuffer thread;
+  return *thread.buffer;
+}
+
+void btw::trace::detail::record(Buffer &buffer, const char *name,
+                                std::int64_t start_ns) {
+  if (const int current = session.load(std::memory_order_relaxed);
+      buffer.session.load(std::memory_order_relaxed) != current) {
+    buffer.count.store(0, std::memory_order_relaxed);
+    buffer.dropped.store(0, std::memory_order_relaxed);
+    buffer.session.store(current, std::memory_order_release);
+  }
+  const auto n = buffer.count.load(std::memory_order_relaxed);
+  if (n == Buffer::capacity) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (!buffer.events) {
+    buffer.events = std::make_unique<Buffer::Event[]>(Buffer::capacity);
+  }
+  buffer.events[n] = {name, start_ns, now_ns() - start_ns};
+  buffer.count.store(n + 1, std::memory_order_release);
+}
+
+void btw::trace::set_enabled(bool enable) {
+  auto &r = registry();
+  const std::lock_guard lock(r.mutex);
+  if (enable && !detail::enabled.load(std::memory_order_relaxed)) {
+    // A new recording: full buffers take events again, and exited threads'
+    // old events are let go.
+    ++session;
+    std::erase_if(r.buffers, [](const std::unique_ptr<Buffer> &buffer) {
+      return buffer->retired;
+    });
+  }
+  detail::enabled.store(enable, std::memory_order_relaxed);
+}
+
+void btw::trace::set_thread_name(const std::string &name) {
+  auto &buffer = detail::thread_buffer();
+  const std::lock_guard lock(registry().mutex);
+  buffer.name = name;
+}
+
+auto btw::trace::dropped_events() -> std::size_t {
+  auto &r = registry();
+  const std::lock_guard lock(r.mutex);
+  std::size_t dropped = 0;
+  for (const auto &buffer : r.buffers) {
+    if (buffer->session.load(std::memory_order_acquire) == session) {
+      dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+  }
+  return dropped;
+}
+
+bool btw::trace::write_json(const std::string &path) {
+  std::ofstream out(path);
+  if (!out) {
+    return false;
+  }
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  auto &r = registry();
+  const std::lock_guard lock(r.mutex);
+  const char *separator = "";
+  for (const auto &buffer : r.buffers) {
+    if (!buffer->name.empty()) {
+      out << separator << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+          << "\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+      btw::write_json_string(out, buffer->name);
+      out << "}}";
+      separator = ",\n";
+    }
+    const auto count =
+        buffer->session.load(std::memory_order_acquire) == session
+            ? buffer->count.load(std::memory_order_acquire)
+            : 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto &[name, start_ns, duration_ns] = buffer->events[i];
+      out << separator << "{\"ph\":\"X\",\"name\":";
+      btw::write_json_string(out, name);
+      out << ",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":"
+          << start_ns / 1000.0 << ",\"dur\":" << duration_ns / 1000.0 << '}';
+      separator = ",\n";
+    }
+  }
+  out << "]}\n";
+  return static_cast<bool>(out);
+}
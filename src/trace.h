@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped trace events, written as Chrome trace JSON (chrome://tracing,
+// Perfetto). Each thread appends to its own fixed-size buffer without
+// locking; events past its capacity are dropped. Enabling tracing starts a
+// new recording, discarding the previous one's events. While tracing is
+// disabled a scope costs one relaxed load and branch.
+namespace btw::trace {
+
+namespace detail {
+extern std::atomic<bool> enabled;
+
+struct Buffer;
+[[nodiscard]] auto now_ns() -> std::int64_t;
+[[nodiscard]] auto thread_buffer() -> Buffer &;
+void record(Buffer &buffer, const char *name, std::int64_t start_ns);
+} // namespace detail
+
+[[nodiscard]] inline bool enabled() {
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+void set_enabled(bool enable);
+
+// Names the calling thread in the trace. The name is copied.
+void set_thread_name(const std::string &name);
+
+// Events lost to full thread buffers.
+[[nodiscard]] auto dropped_events() -> std::size_t;
+
+// Writes the events recorded so far. False if path can't be written.
+[[nodiscard]] bool write_json(const std::string &path);
+
+// Records a complete event from construction to destruction. name must
+// outlive the trace, e.g. a string literal.
+struct Scope {
+  explicit Scope(const char *name) {
+    if (enabled()) {
+      this->name = name;
+      start_ns = detail::now_ns();
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  ~Scope() {
+    if (name) {
+      detail::record(detail::thread_buffer(), name, start_ns);
+    }
+  }
+
+private:
+  const char *name = nullptr;
+  std::int64_t start_ns = 0;
+};
+
+} // namespace btw::trace
+
+#define BTW_TRACE_CONCAT_(a, b) a##b
+#define BTW_TRACE_CONCAT(a, b) BTW_TRACE_CONCAT_(a, b)
+
+// Traces the rest of the enclosing block as name.
+#define BTW_TRACE_SCOPE(name)                                                  \
+  const btw::trace::Scope BTW_TRACE_CONCAT(btw_trace_scope_, __LINE__)(name)
+
+// Traces the rest of the enclosing function under its name.
+#define BTW_TRACE_FUNCTION() BTW_TRACE_SCOPE(__func__)